@@ -0,0 +1,225 @@
+/* common.c */
+/************/
+
+/* Functions shared by reduce.c and discharge.c, each of which includes this
+ * file right after defining VERTS, DEG and tp_confmat. They recognise
+ * configurations that are the same up to a rotation or reflection of the
+ * ring, and hash files and configurations. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HASHINIT 14695981039346656037UL	/* see "Hash" */
+
+typedef struct {
+   long n;		/* number of entries of canon in use */
+   tp_confmat *canon;	/* the distinct "canonical" forms added, */
+   long *number;	/* the number each was added with, */
+   unsigned long *key;	/* and its "Hash" */
+   long size;		/* number of entries of slot, 0 or a power of 2 */
+   long *slot;		/* hash table of the entries of canon, -1 if free */
+} tp_canonset;	/* canonical forms of configurations, see "canonfind" */
+
+
+unsigned long
+Hash(h, p, n)
+unsigned long h;
+char *p;
+long n;
+
+/* Folds the n bytes at p into the hash value h (FNV-1a; start with h equal
+ * to HASHINIT) */
+{
+   for (; n > 0; n--, p++)
+      h = (h ^ (unsigned char) *p) * 1099511628211UL;
+   return (h);
+}
+
+
+unsigned long
+HashFile(F)
+FILE *F;
+
+/* Returns the hash value of the contents of F, which is then rewound */
+{
+   char S[4096];
+   long n;
+   unsigned long h;
+
+   for (h = HASHINIT; (n = (long) fread(S, sizeof(char), sizeof(S), F)) > 0;)
+      h = Hash(h, S, n);
+   rewind(F);
+   return (h);
+}
+
+
+long
+confcmp(A, B)
+tp_confmat A, B;
+
+/* Compares the configurations A and B row after row, returning a negative
+ * number, 0 or a positive number as A is less than, equal to, or greater
+ * than B. Row 0 is compared as a whole, so the entries of it that are not
+ * used must be 0, as in "canonical". */
+{
+   long i, j, n;
+
+   for (j = 0; j < DEG; j++)
+      if (A[0][j] != B[0][j])
+	 return (A[0][j] < B[0][j] ? (long) -1 : (long) 1);
+   n = A[0][0];
+   for (i = 1; i <= n; i++)
+      for (j = 0; j <= A[i][0]; j++)
+	 if (A[i][j] != B[i][j])
+	    return (A[i][j] < B[i][j] ? (long) -1 : (long) 1);
+   return ((long) 0);
+}
+
+
+void
+canonical(A, B)
+tp_confmat A, B;
+
+/* Stores in B the canonical form of the configuration A. For each of the
+ * 2 * ring-size ways of numbering the ring (starting anywhere, in either
+ * direction), the other vertices are numbered in the order in which they
+ * are reached from the ring, taking the vertices in turn and their
+ * neighbours in the same sense as the ring (clockwise starting from the
+ * one with the smallest number so far); the neighbours and the contract are
+ * renumbered accordingly. B is the least of the results, as compared by
+ * "confcmp". So two configurations have the same canonical form if and
+ * only if they are the same up to a rotation or reflection of the ring. */
+{
+   long n, r, s, d, i, j, k, m, v, w, first, next, label[VERTS], vertex[VERTS];
+   tp_confmat C;
+
+   n = A[0][0];
+   r = A[0][1];
+   for (s = 1; s <= r; s++)
+      for (d = -1; d <= 1; d += 2) {
+	 for (v = 1; v <= n; v++)
+	    label[v] = 0;
+	 for (k = 0; k < r; k++) {	/* s, s + d, s + 2d, ... */
+	    v = (s - 1 + d * k + r) % r + 1;
+	    label[v] = k + 1;
+	    vertex[k + 1] = v;
+	 }
+	 for (next = r + 1, k = 1; k < next; k++) {
+	    v = vertex[k];
+	    m = A[v][0];
+	    if (v <= r)	/* the next vertex of the ring */
+	       first = d > 0 ? 1 : m;
+	    else
+	       for (first = 0, j = 1; j <= m; j++)
+		  if (label[A[v][j]] && (!first || label[A[v][j]] < label[A[v][first]]))
+		     first = j;
+	    C[k][0] = m;
+	    for (j = 0; j < m; j++) {
+	       w = A[v][(first - 1 + d * j + m) % m + 1];
+	       if (!label[w]) {
+		  label[w] = next;
+		  vertex[next++] = w;
+	       }
+	       C[k][j + 1] = label[w];
+	    }
+	 }
+	 for (i = 0; i <= 4; i++)
+	    C[0][i] = A[0][i];
+	 for (i = 5; i < DEG; i++)
+	    C[0][i] = 0;
+	 for (i = 0; i < A[0][4]; i++) {	/* the contract, sorted */
+	    v = label[A[0][2 * i + 5]];
+	    w = label[A[0][2 * i + 6]];
+	    if (v > w) {
+	       m = v;
+	       v = w;
+	       w = m;
+	    }
+	    for (j = i; j > 0 && (C[0][2 * j + 3] > v || (C[0][2 * j + 3] == v && C[0][2 * j + 4] > w)); j--) {
+	       C[0][2 * j + 5] = C[0][2 * j + 3];
+	       C[0][2 * j + 6] = C[0][2 * j + 4];
+	    }
+	    C[0][2 * j + 5] = v;
+	    C[0][2 * j + 6] = w;
+	 }
+	 if ((s == 1 && d < 0) || confcmp(C, B) < 0)
+	    for (i = 0; i <= n; i++)
+	       for (j = 0; j < DEG; j++)
+		  B[i][j] = C[i][j];
+      }
+}
+
+
+long
+canonfind(S, A, number)
+tp_canonset *S;
+tp_confmat A;
+long number;
+
+/* Returns the number that the configuration of S with the same "canonical"
+ * form as A was added with, or -1 if there is none, in which case the
+ * canonical form of A is added to S with the given number. S starts out
+ * with all its members 0. The forms are found through a hash table of
+ * their "Hash" values, and then compared in full by "confcmp", so that
+ * configurations whose hash values agree are still told apart. */
+{
+   long i, j;
+   unsigned long k;
+   tp_confmat B;
+
+   canonical(A, B);
+   k = Hash((unsigned long) HASHINIT, (char *) B[0], (long) sizeof(B[0]));
+   for (i = 1; i <= B[0][0]; i++)
+      k = Hash(k, (char *) B[i], (B[i][0] + 1) * (long) sizeof(long));
+   for (i = k & (S->size - 1); S->size && S->slot[i] >= 0; i = (i + 1) & (S->size - 1)) {
+      j = S->slot[i];
+      if (S->key[j] == k && !confcmp(B, S->canon[j]))
+	 return (S->number[j]);
+   }
+   if ((S->n & (S->n - 1)) == 0) {	/* 0 or a power of 2 */
+      S->canon = (tp_confmat *) realloc(S->canon, 2 * (S->n + 1) * sizeof(tp_confmat));
+      S->number = (long *) realloc(S->number, 2 * (S->n + 1) * sizeof(long));
+      S->key = (unsigned long *) realloc(S->key, 2 * (S->n + 1) * sizeof(unsigned long));
+      if (S->canon == NULL || S->number == NULL || S->key == NULL) {
+	 (void) printf("Not enough memory for the canonical forms\n");
+	 exit(44);
+      }
+   }
+   (void) memcpy(S->canon[S->n], B, sizeof(tp_confmat));
+   S->number[S->n] = number;
+   S->key[S->n++] = k;
+   if (2 * S->n > S->size) {	/* keep the table at most half full */
+      free(S->slot);
+      S->size = S->size ? 2 * S->size : 64;
+      S->slot = (long *) malloc(S->size * sizeof(long));
+      if (S->slot == NULL) {
+	 (void) printf("Not enough memory for the canonical forms\n");
+	 exit(44);
+      }
+      for (i = 0; i < S->size; i++)
+	 S->slot[i] = -1;
+      for (j = 0; j < S->n; j++) {
+	 for (i = S->key[j] & (S->size - 1); S->slot[i] >= 0; i = (i + 1) & (S->size - 1));
+	 S->slot[i] = j;
+      }
+   } else {
+      for (i = k & (S->size - 1); S->slot[i] >= 0; i = (i + 1) & (S->size - 1));
+      S->slot[i] = S->n - 1;
+   }
+   return ((long) -1);
+}
+
+
+void
+canonfree(S)
+tp_canonset *S;
+
+/* Frees the space of S, which is then empty again */
+{
+   free(S->canon);
+   free(S->number);
+   free(S->key);
+   free(S->slot);
+   (void) memset((void *) S, 0, sizeof(tp_canonset));
+}
@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 /* constants */
 #define VERTS      40	/* max number of vertices in a free completion + 1 */ // jps
@@ -29,6 +30,7 @@
 #define CARTVERT   5*MAXVAL+2	/* domain of l_A, u_A, where A is an axle */
 char    RULEFILE[99];           /* file containing rules */     // jps (used to be defined as "rules", now entered on command line)
 char    UNAVSET[99];            /* file containing unav set */  // jps (used to be defined as "unavoidable.conf", now entered on command line)
+int     MAXCONFS;               /* max number of configurations, see "IndexCount" */
 #define OUTLETFILE "outlet.et"	/* outlets will be written into this file */
 #define INFTY      12	/* the "12" in the definition of limited part  */
 #define MAXOUTLETS 500	/* max number of outlets */ // jps
@@ -57,6 +59,8 @@ typedef int tp_vertices[CARTVERT];
 typedef int tp_adjmat[CARTVERT][CARTVERT];
 typedef long tp_confmat[VERTS][DEG];	/* must be long */
 
+#include "common.c"	/* "canonical" and "canonfind", as in reduce.c */
+
 typedef struct {
    tp_vertices low;
    tp_vertices upp;
@@ -105,7 +109,8 @@ void CopyAxle(tp_axle *, tp_axle *);
 void PrintAxle(tp_axle *);
 void Indent(int, char[]);
 void Radius(tp_confmat);
-int GetConf(tp_confmat *, tp_question *);
+int IndexCount(void);
+int GetConf(tp_confmat *, tp_question *, int[]);
 long ReadConf(tp_confmat, FILE *, long *);
 void ReadErr(int, char[]);
 int ReadOutlets(tp_axle *, tp_outlet[]);
@@ -135,6 +140,7 @@ void CopyAxle();
 void PrintAxle();
 void Indent();
 void Radius();
+int IndexCount();
 int GetConf();
 long ReadConf();
 void ReadErr();
@@ -833,7 +839,7 @@ int lineno, print;
 tp_axle *A;
 {
    int h, i, j, v, redring, redverts;
-   static int naxles, noconf;
+   static int naxles, noconf, *confno;
    static tp_confmat *conf;
    static tp_edgelist edgelist;
    static tp_adjmat adjmat;
@@ -846,19 +852,23 @@ tp_axle *A;
       for (i = 0; i < MAXASTACK; i++)
 	 ALLOC(Astack[i], 1, tp_axle);
       ALLOC(B, 1, tp_axle);
-      redquestions = (tp_question *) malloc(CONFS * sizeof(tp_question));
+      MAXCONFS = IndexCount();
+      if (MAXCONFS == 0)
+	 MAXCONFS = CONFS;
+      ALLOC(confno, MAXCONFS, int);
+      redquestions = (tp_question *) malloc(MAXCONFS * sizeof(tp_question));
       if (redquestions == NULL) {
 	 fflush(stdout);
-	 (void) fprintf(stderr, "Insufficient memory. Additional %d KBytes needed\n", (int) CONFS * sizeof(tp_question) / 1024);
+	 (void) fprintf(stderr, "Insufficient memory. Additional %d KBytes needed\n", (int) (MAXCONFS * sizeof(tp_question) / 1024));
 	 exit(27);
       }
-      conf = (tp_confmat *) malloc(CONFS * sizeof(tp_confmat));
+      conf = (tp_confmat *) malloc(MAXCONFS * sizeof(tp_confmat));
       if (conf == NULL) {
-	 (void) printf("Not enough memory to store unavoidable set. Additional %d KBytes needed.\n", (int) CONFS * sizeof(tp_confmat) / 1024);
+	 (void) printf("Not enough memory to store unavoidable set. Additional %d KBytes needed.\n", (int) (MAXCONFS * sizeof(tp_confmat) / 1024));
 	 (void) printf("Therefore cannot do isomorphism verification.\n");
 	 fflush(stdout);
       }
-      noconf = GetConf(conf, redquestions);
+      noconf = GetConf(conf, redquestions, confno);
       return (0);
    }
    /* This part is executed when A!=NULL */
@@ -888,7 +898,8 @@ tp_axle *A;
       /* could not use conf[h][0][0], because conf may be NULL           */
 
       if (print) {
-	 (void) printf("Conf(%d,%d,%d): ", h / 70 + 1, (h % 70) / 7 + 1, h % 7 + 1);
+	 i = confno[h];	/* its place in UNAVSET */
+	 (void) printf("Conf(%d,%d,%d): ", i / 70 + 1, (i % 70) / 7 + 1, i % 7 + 1);
 	 for (j = 1; j <= redverts; j++) {
 	    if (image[j] != -1)
 	       (void) printf(" %d(%d)", image[j], j);
@@ -1230,21 +1241,57 @@ tp_confmat L;
 }/* Radius */
 
 
+/*********************************************************************
+            IndexCount
+Returns the number of configurations in UNAVSET according to its index,
+the file UNAVSET.idx made by "reduce --index", or 0 if there is no index
+or it is out of date. The first line of the index is
+	index <size> <hash> <number of configurations>
+where hash is the "HashFile" of UNAVSET.
+*********************************************************************/
+int
+IndexCount()
+{
+   char S[MAXSTR];
+   long size, n;
+   unsigned long h, hash;
+   struct stat st;
+   FILE *F;
+
+   (void) sprintf(S, "%s.idx", UNAVSET);
+   if (stat(UNAVSET, &st) || (F = fopen(S, "r")) == NULL)
+      return (0);
+   if (fgets(S, sizeof(S), F) == NULL || sscanf(S, "index %ld %lx %ld", &size, &h, &n) != 3
+       || size != (long) st.st_size)
+      n = 0;
+   (void) fclose(F);
+   if (n == 0 || (F = fopen(UNAVSET, "r")) == NULL)
+      return (0);
+   hash = HashFile(F);
+   (void) fclose(F);
+   return (hash == h ? (int) n : 0);
+}/* IndexCount */
+
+
 /*********************************************************************
             GetConf
 Reads unavoidable set from the file called UNAVSET. For the i-th member
 (i=0,1,...), say L, it verifies that L has radius at most two, computes
 a question for L and stores it in redquestions[i], and if conf!=NULL it
-stores L in conf[i].
+stores L in conf[i]. Members that are isomorphic to an earlier one (see
+"canonfind") are passed over, as "Reduce" would never get to them;
+confno[i] is the place in the file of the i-th member kept.
 **********************************************************************/
 int
-GetConf(conf, redquestions)
+GetConf(conf, redquestions, confno)
 tp_confmat *conf;
 tp_question *redquestions;
+int confno[];
 
 {
-   int noconf, nonull;
+   int noconf, nonull, nread;
    tp_confmat *A;
+   tp_canonset canon;
    FILE *F;
 
    noconf = 0;
@@ -1261,20 +1308,28 @@ tp_question *redquestions;
    }
    (void) printf("Reading unavoidable set from file `%s'.\n", UNAVSET);
    fflush(stdout);
-   for (noconf = 0; !ReadConf(*conf, F, NULL); noconf++) {
-      if (noconf >= CONFS) {
+   (void) memset((void *) &canon, 0, sizeof(canon));
+   for (nread = noconf = 0; !ReadConf(*conf, F, NULL); nread++) {
+      if (noconf >= MAXCONFS) {
 	 fflush(stdout);
-	 (void) fprintf(stderr, "More than %d configurations\n", CONFS);
+	 (void) fprintf(stderr, "More than %d configurations\n", MAXCONFS);
 	 exit(24);
       }
+      if (canonfind(&canon, *conf, (long) nread) >= 0)
+	 continue;
+      confno[noconf] = nread;
       GetQuestion(*conf, redquestions[noconf]);
       Radius(*conf);
       if (nonull)
 	 conf++;
+      noconf++;
    }
    if (!nonull)
       free(conf);
-   (void) printf("Total of %d configurations.\n", noconf);
+   canonfree(&canon);
+   (void) printf("Total of %d configurations.\n", nread);
+   if (noconf < nread)
+      (void) printf("%d of them are isomorphic to earlier ones and are not used.\n", nread - noconf);
    fflush(stdout);
    (void) fclose(F);
    return (noconf);
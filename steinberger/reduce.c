@@ -17,51 +17,464 @@
 
 /* Version 1,  8 May 1995 */
 
-#define VERTS   30	/* max number of vertices in a free completion + 1 */ // jps
+#define VERTS   (2 * MAXRING + 2)	/* max number of vertices in a free completion + 1 */
+			/* those of U_2822.conf have at most 2r - 3 for ring-size r */
 #define DEG     13	/* max degree of a vertex in a free completion + 1 */
 			/* must be at least 13 because of row 0            */
-#define EDGES   70	/* max number of edges in a free completion + 1    */ // jps
-#define MAXRING 16	/* max ring-size */ // jps
+#define EDGES   (3 * VERTS - 7)	/* max number of edges in a free completion + 1    */
+			/* one with n vertices and ring-size r has 3n - 3 - r */
+#define MAXRING 20	/* max ring-size */
+#define MAXMATCH (MAXRING / 2)	/* max number of matches in a matching */
+#define MAXSIGN (1 << (MAXMATCH - 1))	/* max number of its signings */
+#define MASKS ((MAXSIGN + 63) / 64)	/* words of the mask of a "tp_survivor" */
+#define MAXINTERVAL ((MAXRING + 3) / 4)	/* max number of intervals of "augment" */
+#define MAXJOBS 4	/* configurations per worker that may be in flight */
+#define MAXITER 64	/* max number of iterations kept in the cache */
+#define SPLITRING 14	/* min ring-size for which the work is split */
+#define LIVEPARTS 256	/* max number of parts of "findlive" */
+#define GATHERDEPTH 7	/* min depth of a matching for "stillgather" */
+#define SURVIVORS 50331648	/* max space of the matchings kept, see "keeping" */
+#define SURVIVORBASE 1024	/* entries of the first chunk of a "tp_survivors" */
+#define SURVIVORCHUNKS 16	/* max number of chunks, each twice the last */
+#define TABLEPARTS 256	/* max number of parts of a table, see "OpenTable" */
+#define TABLEHEAD 64	/* size of the header of a table, see "MakeTables" */
+#define TABLERING 16	/* max ring-size of the tables, see "MakeTables" */
+#define EXPANDRING 13	/* max ring-size for "OpenExpand" */
+#define SPARSELIVE 32	/* "live" is folded as a list once fewer than */
+			/* 1/SPARSELIVE of the codes are live */
+#define FRONTSTATES 4194304	/* max number of partial colourings kept */
+			/* by "frontlive" */
+#define CONFTEXT (21 * VERTS * DEG)	/* max length of a "ConfText" */
+#define LIVE(live, i)	(((live)[(i) >> 1] >> (((i) & 1) << 2)) & 15)
+#define LIVEBITS(i, b)	((char) ((b) << (((i) & 1) << 2)))
+			/* "live" has 4 bits per code, see "testconf" */
+#define STARVED(cnt, c)	((c) ? !(cnt)[4 * (c)] || !(cnt)[4 * (c) + 1] || !(cnt)[4 * (c) + 2] \
+			: !((cnt)[0] | (cnt)[1] | (cnt)[2]))
+			/* code c is left unmarked, see "fixlive" */
+#define LANES(c, plane, f, k, ring)	((f) <= (ring) + 3 ? (plane)[(f) - (ring)][k] : (c)[f] == 1L << (k) ? ~0UL : 0UL)
+			/* the bits in which edge f has colour 2^k, see "livebits" */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86SIMD	/* "updatelive" and "stillreal" may use SSE2, AVX2 or */
+			/* AVX-512, see "foldlive" and "stillgather" */
+#include <immintrin.h>
+#endif
+
+typedef long tp_confmat[VERTS][DEG];	/* row 0 holds counts, see "ReadConf" */
+
+#include "common.c"	/* "canonical", "canonfind" and "Hash" */
+
+typedef unsigned char tp_angle[EDGES][5];	/* edge numbers are less than EDGES, */
+typedef unsigned char tp_edgeno[EDGES][EDGES];	/* and so fit in a character */
+
+typedef struct {
+   long start;		/* the bit of "real" of its first signing */
+   unsigned char match[MAXMATCH + 1][2];	/* match i is match[i][0] to match[i][1] */
+   char depth, on;	/* number of matches, and as in "augment" */
+   unsigned long mask[MASKS];	/* bit k is set if signing k is still real */
+} tp_survivor;	/* a matching with signings that are still real */
+/* mask must come last: a "tp_survivors" only keeps as much of it as the
+ * ring-size needs */
+
+typedef struct {
+   char *chunk[SURVIVORCHUNKS];	/* allocated as needed, see "survivor" */
+   long words;		/* number of words of mask kept in each entry, */
+   long stride;		/* and so the size of an entry */
+   long n, max;		/* number of entries in use, and max number of them */
+   long full;		/* nonzero if some did not fit */
+} tp_survivors;	/* the matchings left after a pass of "testmatch" */
+/* n, full and chunk are only accessed atomically */
+
+typedef struct {
+   unsigned char match[MAXMATCH + 1][2];	/* as in "tp_survivor" */
+   unsigned char depth, on;
+} tp_matching;	/* an entry of a table of matchings, see "MakeTables" */
+
+typedef struct {
+   unsigned int *at;	/* signed matching m has codes at[m]..at[m+1]-1 */
+   unsigned char *code;	/* 3 bytes each: twice the code, plus 1 if twisted */
+} tp_expand;	/* the colourings of each signed matching, see "OpenExpand" */
+
+typedef struct {
+   long number;		/* position in the input file, counting from 0 */
+   long status;		/* exit status called for by the configuration */
+   long done;		/* nonzero once everything has been written to out */
+   tp_confmat graph;
+   tp_angle angle, diffangle, sameangle;	/* see "findangles" */
+   long contract[EDGES + 1];
+   FILE *out;		/* all output about the configuration goes here */
+   char *text;		/* the buffer behind out when running in parallel */
+   size_t size;
+   double cost;		/* predicted time to verify it, see "predictcost" */
+   double seconds;	/* time it actually took, -1 if it could not be read */
+   unsigned long hash;	/* see "ConfHash" */
+   long original;	/* if >= 0, an earlier configuration isomorphic to it */
+   long nlive;		/* number of colourings left at the end */
+   long iterations;	/* number of times "testmatch" was run */
+   long split;		/* number of threads among which to split it */
+   long extent;		/* number of colourings that extend */
+   long trace[2 * MAXITER];	/* nreal and nlive after each iteration */
+   char folds[MAXITER + 1];	/* how each iteration updated "live", see "PrintCost" */
+   tp_survivors *survivors;	/* if not NULL, where "augment" keeps them */
+   tp_expand *expand;	/* if not NULL, the colourings "stillreal" forms */
+   jmp_buf abort;	/* where "Fail" returns to */
+} tp_job;	/* a configuration being verified */
+
+typedef struct {
+   FILE *fp;		/* open for appending */
+   long size;		/* number of entries of proven and hash */
+   char *proven;	/* nonzero if configuration i+1 is in the journal, */
+   unsigned long *hash;	/* and then its "ConfHash" */
+   char **text;		/* and its "ConfText" */
+} tp_journal;	/* the configurations verified by earlier runs */
+
+typedef struct {
+   FILE *fp;		/* open for appending */
+   long size;		/* number of entries of key and entry, a power of 2 */
+   unsigned long *key;	/* hash table of "CacheKey", 0 for a free entry */
+   char **entry;	/* the rest of the line of the cache for that key */
+   unsigned long program;	/* hash of the program, see "OpenCache" */
+   long sample;		/* percentage of the results found to verify again */
+   unsigned long seed;	/* chooses that sample, see "Resample" */
+   long hits;		/* number of configurations taken from the cache */
+   long checked;	/* number of them verified again */
+} tp_cache;	/* the results of earlier runs, by configuration */
+
+typedef struct {
+   long nthreads;	/* number of workers, see "-j" */
+   long schedule;	/* nonzero to verify the costliest configurations first */
+   FILE *costs;		/* if not NULL, predicted and actual costs go here */
+   FILE *results;	/* if not NULL, the verdict on each configuration */
+   tp_journal *journal;	/* if not NULL, where verified configurations go */
+   tp_cache *cache;	/* if not NULL, results of earlier runs */
+} tp_opts;	/* the command line options */
+
+typedef struct {
+   FILE *fp;
+   long nseen;		/* number of entries of fp passed so far */
+   long shard, nshards;	/* only entry i with i % nshards == shard - 1 is read */
+   long first, last;	/* and only if first <= i <= last, or last < 0 */
+   long ringsize;	/* and if nonzero, only if it has this ring-size */
+   long nindex;		/* number of entries of offset and rings */
+   long *offset;	/* if not NULL, where each entry of fp starts, */
+   long *rings;		/* and its ring-size, see "OpenIndex" */
+   long dedup;		/* nonzero to verify isomorphic configurations once */
+   tp_canonset canon;	/* the forms read so far, each with the first */
+			/* configuration that has it */
+} tp_input;	/* the configuration file */
+
+typedef struct {
+   tp_input *in;
+   long *power;
+   tp_opts *opts;
+   long window;		/* number of entries of jobs */
+   tp_job **jobs;	/* the i-th configuration read is in *jobs[i % window] */
+   long *order;		/* if not NULL, the order in which to verify them */
+   long nread;		/* number of configurations read so far */
+   long ndispatched;	/* number of them handed out to workers */
+   long nprinted;	/* number of configurations printed so far */
+   long eof;		/* nonzero once nothing more is to be read */
+   long nbusy;		/* number of workers verifying a configuration */
+   pthread_mutex_t lock;	/* guards "done" in the jobs */
+   pthread_cond_t progress;	/* signalled when a job is done */
+} tp_pool;	/* the state shared by the threads of "-j" */
+/* jobs[] is a bounded queue without locks: entry nread % window is filled
+ * by "producer" and then published by increasing nread; workers claim
+ * entries by increasing ndispatched; an entry is free again once nprinted
+ * has passed it. These three counters are only accessed atomically, as is
+ * nbusy. */
 
-typedef long tp_confmat[VERTS][DEG];
-typedef long tp_angle[EDGES][5];
-typedef long tp_edgeno[EDGES][EDGES];
+typedef struct {
+   int *code;		/* the live codes, in increasing order */
+   long n;		/* number of them, or -1 while "live" is dense */
+   long max;		/* number of entries of code allocated */
+} tp_livelist;	/* the live colourings once there are few, see "updatelive" */
+
+typedef struct {
+   unsigned long *front;	/* the colours of the frontier, ~0 if unused */
+   unsigned long *ring;	/* the colours of the ring edges found so far */
+   long n;		/* number of entries in use */
+   long size;		/* number of entries allocated, a power of 2 */
+} tp_frontier;	/* a set of partial colourings, see "frontlive" */
+
+typedef struct {
+   char *live, *real;
+   long ring;		/* the largest ring-size they have room for */
+   tp_survivors kept;	/* see "keeping" */
+   tp_livelist sparse;
+   tp_pool *pool;
+} tp_work;	/* the scratch space of one worker */
+
+typedef struct {
+   long a, b;		/* its first match; a == ring if it is incident */
+   long on;		/* with the last ring edge, and then on is 1 */
+   long start;		/* number of signed matchings generated before it */
+   long size;		/* number of signed matchings generated from it */
+   long first, last;	/* or entries first..last-1 of a table, if it has one */
+} tp_part;	/* one of the top-level calls of "augment" by "testmatch" */
+
+typedef struct {
+   tp_matching *match;	/* the matchings, mapped from the file */
+   long nmatch;
+   tp_part *parts;	/* runs of them for "splitmatch" */
+   long nparts;
+} tp_table;	/* the matchings of a ring-size, see "OpenTable" */
+
+typedef struct {
+   tp_job *J;
+   tp_part *parts;	/* see "matchparts", or of table if not NULL */
+   tp_table *table;
+   long nparts;
+   long next;		/* number of parts claimed so far */
+   long matchweight[2][MAXRING + 1][MAXRING + 1][4];	/* by on, see "testmatch" */
+   char *live, *real;
+   long ring, basecol, nchar;
+   long nreal;		/* as in "testmatch" */
+   long status;		/* nonzero if some part called "Fail" */
+} tp_split;	/* a pass of "testmatch" split among threads */
+/* next, nreal and status are only accessed atomically */
+
+typedef struct {
+   long (*prefix)[EDGES];	/* colours of the edges from top up, see "findlive" */
+   long nprefix;
+   long top;
+   long next;		/* number of prefixes claimed so far */
+   unsigned char (*angle)[5];
+   long *power;
+   long ncodes;
+   unsigned char **seen;	/* a set of codes for each thread */
+   long nseen;		/* number of entries of seen in use */
+   long status;		/* nonzero if memory ran out */
+} tp_livesplit;	/* "findlive" split among threads */
+/* next, nseen and status are only accessed atomically */
+
+/* number of balanced signed matchings, by ring-size up to 16; "matchparts"
+ * checks its counts against them */
+static long simatchnumber[] = {0L, 0L, 1L, 3L, 10L, 30L, 95L, 301L, 980L, 3228L, 10797L, 36487L, 124542L, 428506L, 1485003L, 5178161L,  18155816L}; // jps
+
+/* the directory of the tables of "--tables", or NULL */
+static char *tabledir = NULL;
+
+/* nonzero if "--expand" was given */
+static long expanding = 0;
+
+/* nonzero if "--worklist" was given */
+static long worklist = 0;
+
+/* nonzero if "--frontier" was given */
+static long frontier = 0;
+
+/* nonzero if "--huge" was given */
+static long hugepages = 0;
+
+/* the directory of "--spill", or NULL */
+static char *spilldir = NULL;
 
 /* function prototypes */
 #ifdef PROTOTYPE_MAX
-void testmatch(long, char *, long[], char *, long);
-void augment(long, long[], long, long **, long[MAXRING+1][MAXRING+1][4], char *, char *, long *, long, long, long, char *, long *, long); // jps
-void checkreality(long, long **, char *, char *, long *, long, long, long, char *, long *, long);
-long stillreal(long, long[], long, char *, long);
-long updatelive(char *, long, long *);
+long testmatch(long, char *, long[], char *, long, tp_job *);
+long splitmatch(long, char *, long[], char *, long, tp_table *, tp_job *);
+long tablematch(long, char *, long[], char *, long, tp_table *, tp_job *);
+void runtable(tp_table *, long, long, long, long[2][MAXRING+1][MAXRING+1][4], char *, char *, long *, long, long, long, long, tp_job *);
+void matchweights(long, long[], long[2][MAXRING+1][MAXRING+1][4]);
+void *helper(void *);
+tp_part *matchparts(long, long *);
+long countmatch(long, long[], long);
+long matchnumber(long);
+void tabulate(long, long[], long, tp_matching *, FILE *, long *, long *);
+void MakeTables(char[]);
+long writetable(long, FILE *, long *);
+tp_table *OpenTable(long);
+tp_expand *OpenExpand(long, long[]);
+long colourings(long **, long, long, long, long, long[]);
+void augment(long, long[], long, long **, long[MAXRING+1][MAXRING+1][4], char *, char *, long *, long, long, long, char *, long *, long, long, tp_job *);
+void checkreality(long, long **, char *, char *, long *, long, long, long, char *, long *, tp_survivor *, long, long, tp_job *);
+void keepmatch(tp_survivors *, tp_survivor *, long, long **, long[MAXRING+1][MAXRING+1][4], long, long);
+tp_survivor *survivor(tp_survivors *, long, long);
+long realsigns(unsigned long[], long);
+long survivematch(long, char *, long[], char *, tp_survivors *, tp_job *);
+tp_survivors *keeping(tp_work *, long);
+long stillreal(long, long[], long, char *, long, long);
+long stilltable(tp_expand *, long, char *, long, long);
+long updatelive(char *, long, long *, tp_livelist *, tp_job *);
+long foldlist(char *, tp_livelist *);
+void makelist(char *, long, long, tp_livelist *);
+long fixlive(long, char *, long[], char *, long, long *, tp_survivors *, tp_job *);
+void printverdict(long, tp_job *);
+long foldlive(char *, long, long);
+#ifdef X86SIMD
+long foldsse2(char *, long);
+long foldavx2(char *, long);
+long stillgather(long, long[], long, char *, long, long);
+long stillgather512(long, long[], long, char *, long, long);
+void marklive(int[], long, char *, long, long);
+#endif
 void strip(tp_confmat, tp_edgeno);
 long ininterval(long[], long[]);
-void findangles(tp_confmat, tp_angle, tp_angle, tp_angle, long[]);
-long findlive(char *, long, tp_angle, long[], long);
-void checkcontract(char *, long, tp_angle, tp_angle, long[], long[]);
-void printstatus(long, long, long, long);
-void record(long[], long[], long, long[][5], char *, long *, long);
+void findangles(tp_confmat, tp_angle, tp_angle, tp_angle, long[], tp_job *);
+long findlive(char *, long, tp_angle, long[], long, tp_job *);
+void livetree(long[], long[], long, tp_angle, long[], char *, long *, unsigned char *);
+void livebits(long[], tp_angle, long[], char *, long *, unsigned char *, long);
+long splitlive(char *, long, tp_angle, long[], long[], tp_job *);
+long frontlive(char *, tp_angle, long[]);
+long frontadd(tp_frontier *, unsigned long, unsigned long);
+void frontclear(tp_frontier *);
+void frontfree(tp_frontier *, tp_frontier *);
+void *livehelper(void *);
+long splitting(tp_work *, long);
+long colourcode(long[], long[], long, tp_angle, long);
+void checkcontract(char *, long, tp_angle, tp_angle, long[], long[], tp_job *);
+void printstatus(long, long, long, long, tp_job *);
+void record(long[], long[], long, tp_angle, char *, long *, long);
 long inlive(long[], long[], long, char *, long);
-long ReadConf(tp_confmat, FILE *, long *);
-void ReadErr(int, char[]);
+long ReadConf(tp_confmat, FILE *, long *, tp_job *);
+void ReadErr(int, char[], tp_job *);
+void Fail(tp_job *, long);
+tp_work *NewWork(void);
+long roomfor(tp_work *, long, long[]);
+void FreeWork(tp_work *, long[]);
+char *BigAlloc(long);
+void BigFree(char *, long);
+void testconf(tp_job *, tp_work *, long[]);
+long verify(tp_job *, tp_work *, long[], tp_opts *);
+long ReadJob(tp_job *, tp_input *);
+long SkipConf(FILE *);
+double predictcost(tp_confmat, long[]);
+void PrintCost(tp_job *, FILE *);
+void PrintResult(tp_job *, tp_opts *, long[]);
+long RunSerial(tp_input *, long[], tp_opts *);
+long RunParallel(tp_input *, long[], tp_opts *);
+long ReadAll(tp_pool *);
+void *producer(void *);
+void *worker(void *);
+void Pause(long *);
+void Merge(int, char *[]);
+void MergeErr(char[], char[], long);
+unsigned long ConfHash(tp_confmat);
+void ConfText(tp_confmat, char *);
+long Isomorph(tp_job *, tp_input *);
+void OpenIndex(tp_input *, char[], long);
+long LoadIndex(tp_input *, char[], struct stat *, unsigned long);
+void MakeIndex(tp_input *);
+void IndexAdd(tp_input *, long, long);
+tp_journal *OpenJournal(char[], long);
+long Journaled(tp_job *, tp_journal *, char *);
+void JournalAdd(tp_job *, tp_journal *, char *);
+tp_cache *OpenCache(char[], long, char[]);
+unsigned long CacheKey(tp_job *, tp_cache *);
+char *Cached(tp_job *, tp_cache *, char *);
+long Resample(tp_job *, tp_cache *);
+long Replay(tp_job *, char *, long[]);
+void CacheAdd(tp_job *, tp_cache *, char *, char *);
+void CacheLine(tp_job *, char *, char *);
 #else
-void testmatch();
+long testmatch();
+long splitmatch();
+long tablematch();
+void runtable();
+void matchweights();
+void *helper();
+tp_part *matchparts();
+long countmatch();
+long matchnumber();
+void tabulate();
+void MakeTables();
+long writetable();
+tp_table *OpenTable();
+tp_expand *OpenExpand();
+long colourings();
 void augment();
 void checkreality();
+void keepmatch();
+tp_survivor *survivor();
+long realsigns();
+long survivematch();
+tp_survivors *keeping();
 long stillreal();
+long stilltable();
 long updatelive();
+long foldlist();
+void makelist();
+long fixlive();
+void printverdict();
+long foldlive();
+#ifdef X86SIMD
+long foldsse2();
+long foldavx2();
+long stillgather();
+long stillgather512();
+void marklive();
+#endif
 void strip();
 long ininterval();
 void findangles();
 long findlive();
+void livetree();
+void livebits();
+long splitlive();
+long frontlive();
+long frontadd();
+void frontclear();
+void frontfree();
+void *livehelper();
+long splitting();
+long colourcode();
 void checkcontract();
 void printstatus();
 void record();
 long inlive();
 long ReadConf();
 void ReadErr();
+void Fail();
+tp_work *NewWork();
+long roomfor();
+void FreeWork();
+char *BigAlloc();
+void BigFree();
+void testconf();
+long verify();
+long ReadJob();
+long SkipConf();
+double predictcost();
+void PrintCost();
+void PrintResult();
+long RunSerial();
+long RunParallel();
+long ReadAll();
+void *producer();
+void *worker();
+void Pause();
+void Merge();
+void MergeErr();
+unsigned long ConfHash();
+void ConfText();
+long Isomorph();
+void OpenIndex();
+long LoadIndex();
+void MakeIndex();
+void IndexAdd();
+tp_journal *OpenJournal();
+long Journaled();
+void JournalAdd();
+tp_cache *OpenCache();
+unsigned long CacheKey();
+char *Cached();
+long Resample();
+long Replay();
+void CacheAdd();
+void CacheLine();
 #endif
 
 
@@ -69,341 +482,3108 @@ main(argc, argv)
 int argc;
 char *argv[];
 {
-   long ring, nlive, ncodes, i, nchar, count, power[MAXRING + 2], contract[EDGES + 1]; // jps
-   tp_angle angle, diffangle, sameangle;
-   tp_confmat graph;
-   char *live, *real, *s;
-   FILE *fp;
-   static long simatchnumber[] = {0L, 0L, 1L, 3L, 10L, 30L, 95L, 301L, 980L, 3228L, 10797L, 36487L, 124542L, 428506L, 1485003L, 5178161L,  18155816L}; // jps
+   long i, count, resume, sample, index, select, power[MAXRING + 2];
+   char *s, *results, *journal, *cache;
+   tp_opts opts;
+   tp_input in;
 
-   if (argc < 2)
-      s = "unavoidable.conf";
-   else
-      s = argv[1];
-   fp = fopen(s, "r");
-   if (fp == NULL) {
+   s = "unavoidable.conf";
+   results = journal = cache = NULL;
+   resume = sample = index = 0;
+   opts.nthreads = 1;
+   opts.schedule = 0;
+   opts.costs = opts.results = NULL;
+   in.shard = in.nshards = 1;
+   in.first = in.ringsize = 0;
+   in.last = -1;
+   in.dedup = 0;
+   (void) memset((void *) &in.canon, 0, sizeof(in.canon));
+   for (i = 1; i < argc; i++) {
+      if (!strcmp(argv[i], "-j") && i + 1 < argc)
+	 opts.nthreads = atol(argv[++i]);
+      else if (!strncmp(argv[i], "-j", 2))
+	 opts.nthreads = atol(argv[i] + 2);
+      else if (!strcmp(argv[i], "--schedule"))
+	 opts.schedule = 1;
+      else if (!strcmp(argv[i], "--costs") && i + 1 < argc) {
+	 opts.costs = fopen(argv[++i], "w");
+	 if (opts.costs == NULL) {
+	    (void) printf("Can't open %s\n", argv[i]);
+	    exit(1);
+	 }
+	 (void) fprintf(opts.costs, "# conf ring edges verts  predicted     actual folds\n");
+      } else if (!strcmp(argv[i], "--shard") && i + 1 < argc) {
+	 if (sscanf(argv[++i], "%ld/%ld", &in.shard, &in.nshards) != 2 || in.shard < 1 || in.shard > in.nshards)
+	    opts.nthreads = 0;
+      } else if (!strcmp(argv[i], "--result") && i + 1 < argc)
+	 results = argv[++i];
+      else if (!strcmp(argv[i], "--journal") && i + 1 < argc)
+	 journal = argv[++i];
+      else if (!strcmp(argv[i], "--resume"))
+	 resume = 1;
+      else if (!strcmp(argv[i], "--id") && i + 1 < argc) {
+	 in.first = in.last = atol(argv[++i]) - 1;
+	 if (in.first < 0)
+	    opts.nthreads = 0;
+      } else if (!strcmp(argv[i], "--range") && i + 1 < argc) {
+	 if (sscanf(argv[++i], "%ld-%ld", &in.first, &in.last) != 2 || in.first < 1 || in.last < in.first)
+	    opts.nthreads = 0;
+	 in.first--;
+	 in.last--;
+      } else if (!strcmp(argv[i], "--ring-size") && i + 1 < argc) {
+	 in.ringsize = atol(argv[++i]);
+	 if (in.ringsize < 2)
+	    opts.nthreads = 0;
+      } else if (!strcmp(argv[i], "--index"))
+	 index = 1;
+      else if (!strcmp(argv[i], "--dedup"))
+	 in.dedup = 1;
+      else if (!strcmp(argv[i], "--cache") && i + 1 < argc)
+	 cache = argv[++i];
+      else if (!strcmp(argv[i], "--verify-cache") && i + 1 < argc) {
+	 sample = atol(argv[++i]);
+	 if (sample < 1 || sample > 100)
+	    opts.nthreads = 0;
+      }
+      else if (!strcmp(argv[i], "--tables") && i + 1 < argc)
+	 tabledir = argv[++i];
+      else if (!strcmp(argv[i], "--expand"))
+	 expanding = 1;
+      else if (!strcmp(argv[i], "--worklist"))
+	 worklist = 1;
+      else if (!strcmp(argv[i], "--frontier"))
+	 frontier = 1;
+      else if (!strcmp(argv[i], "--huge"))
+	 hugepages = 1;
+      else if (!strcmp(argv[i], "--spill") && i + 1 < argc)
+	 spilldir = argv[++i];
+      else if (!strcmp(argv[i], "--make-tables") && i + 1 < argc) {
+	 MakeTables(argv[++i]);
+	 return (0);
+      } else if (!strcmp(argv[i], "--merge")) {
+	 Merge(argc - i - 1, argv + i + 1);
+	 return (0);
+      } else if (argv[i][0] == '-' && argv[i][1] != '\0')
+	 opts.nthreads = 0;
+      else
+	 s = argv[i];
+   }
+   if (opts.nthreads < 1 || (resume && journal == NULL) || (sample && cache == NULL)) {
+      (void) printf("Usage: %s [-j <number of threads>] [--schedule] [--costs <file>]\n", argv[0]);
+      (void) printf("          [--shard <k>/<n>] [--result <file>] [--journal <file> [--resume]]\n");
+      (void) printf("          [--cache <file> [--verify-cache <percent>]] [--dedup]\n");
+      (void) printf("          [--id <n> | --range <m>-<n>] [--ring-size <r>] [--tables <directory>]\n");
+      (void) printf("          [--expand] [--worklist] [--frontier] [--huge | --spill <directory>]\n");
+      (void) printf("          [<configuration file>]\n");
+      (void) printf("       %s --index [<configuration file>]\n", argv[0]);
+      (void) printf("       %s --make-tables <directory>\n", argv[0]);
+      (void) printf("       %s --merge <result file> ...\n", argv[0]);
+      (void) printf("--schedule verifies the costliest configurations first (with -j),\n");
+      (void) printf("--costs writes the predicted and actual time of each configuration,\n");
+      (void) printf("--shard verifies only configurations k, k+n, k+2n, ... of the file,\n");
+      (void) printf("--result writes the verdicts to a file, which --merge combines with\n");
+      (void) printf("those of the other shards, --journal records each configuration verified,\n");
+      (void) printf("and --resume passes over those recorded by an earlier run. --cache keeps\n");
+      (void) printf("the results of each configuration verified, so that later runs on the\n");
+      (void) printf("same configurations only print them, except for the given percentage of\n");
+      (void) printf("them with --verify-cache, which are verified again. --dedup verifies only\n");
+      (void) printf("once configurations that are the same up to a rotation or reflection.\n");
+      (void) printf("--id, --range and --ring-size verify only the configurations chosen,\n");
+      (void) printf("finding them with the index <configuration file>.idx, which is made\n");
+      (void) printf("when missing or out of date; --index just makes it. --tables reads the\n");
+      (void) printf("balanced signed matchings of each ring-size from the tables that\n");
+      (void) printf("--make-tables writes to the directory, instead of generating them.\n");
+      (void) printf("--expand keeps the colourings of each of them for ring-sizes up to %d,\n", EXPANDRING);
+      (void) printf("instead of forming them again in each iteration. --worklist does the\n");
+      (void) printf("iterations after the first by examining again only the signed matchings\n");
+      (void) printf("of the colourings that drop out, instead of all of them. --frontier\n");
+      (void) printf("finds the colourings that extend by keeping only the colours of the edges\n");
+      (void) printf("still to be met, merging the partial colourings that agree on them.\n");
+      (void) printf("--huge asks for huge pages for the colourings and signed matchings of\n");
+      (void) printf("each configuration, and --spill keeps them in files of the directory,\n");
+      (void) printf("which can be paged out.\n");
+      (void) printf("The configuration file - is standard input.\n");
+      exit(2);
+   }
+   in.fp = strcmp(s, "-") ? fopen(s, "r") : stdin;
+   if (in.fp == NULL) {
       (void) printf("Can't open %s\n", s);
       exit(1);
    }
+   in.nseen = in.nindex = 0;
+   in.offset = in.rings = NULL;
+   select = in.first > 0 || in.last >= 0 || in.ringsize;
+   if (index || select) {
+      if (in.fp == stdin) {
+	 (void) printf("--index and the selections need a configuration file, not standard input\n");
+	 exit(2);
+      }
+      if (results != NULL) {
+	 (void) printf("--result verifies the whole file, and can't be used with a selection\n");
+	 exit(2);
+      }
+      OpenIndex(&in, s, index);
+      if (index) {
+	 (void) printf("Index of %ld configurations written to %s.idx\n", in.nindex, s);
+	 return (0);
+      }
+   }
+   if (results != NULL) {
+      if (in.fp == stdin) {
+	 (void) printf("--result needs a configuration file, not standard input\n");
+	 exit(2);
+      }
+      opts.results = fopen(results, "w");
+      if (opts.results == NULL) {
+	 (void) printf("Can't open %s\n", results);
+	 exit(1);
+      }
+      (void) fprintf(opts.results, "shard %ld %ld %016lx\n", in.shard, in.nshards, HashFile(in.fp));
+      (void) fflush(opts.results);
+   }
+   opts.journal = journal != NULL ? OpenJournal(journal, resume) : NULL;
+   opts.cache = cache != NULL ? OpenCache(cache, sample, argv[0]) : NULL;
    power[1] = 1;
    for (i = 2; i <= MAXRING + 1; i++) // jps
       power[i] = 3 * power[i - 1];	/* power[i] = 3^(i-1) for i>0 */
-   ncodes = (power[MAXRING] + 1) / 2;	/* max number of codes */
-   live = (char *) malloc(ncodes * sizeof(char));
-   nchar = simatchnumber[MAXRING] / 8 + 2;
-   real = (char *) malloc(nchar * sizeof(char));
-   if (live == NULL || real == NULL) {
-      i = (ncodes + nchar) * sizeof(char);
-      (void) printf("Not enough memory. %ld Kbytes needed.\n", i / 1024 + 1);
-      exit(44);
+   if (opts.nthreads == 1)
+      count = RunSerial(&in, power, &opts);
+   else
+      count = RunParallel(&in, power, &opts);
+   (void) fclose(in.fp);
+   canonfree(&in.canon);
+   if (in.offset != NULL) {
+      free(in.offset);
+      free(in.rings);
+   }
+   if (opts.costs != NULL)
+      (void) fclose(opts.costs);
+   if (opts.journal != NULL)
+      (void) fclose(opts.journal->fp);
+   if (opts.cache != NULL) {
+      (void) fclose(opts.cache->fp);
+      (void) fprintf(stderr, "%ld configurations found in the cache, %ld of them verified again\n", opts.cache->hits + opts.cache->checked, opts.cache->checked);
    }
-   for (count = 0; !ReadConf(graph, fp, NULL); count++) {
-      findangles(graph, angle, diffangle, sameangle, contract);
-      /* "findangles" fills in the arrays "angle","diffangle","sameangle" and
-       * "contract" from the input "graph". "angle" will be used to compute
-       * which colourings of the ring edges extend to the configuration; the
-       * others will not be used unless a contract is specified, and if so
-       * they will be used in "checkcontract" below to verify that the
-       * contract is correct. */
-      ring = graph[0][1];	/* ring-size */
-      if (ring > MAXRING) {
-	 (void) printf("Ring-size bigger than %d\n", MAXRING);
-	 exit(43);
-      }
-      ncodes = (power[ring] + 1) / 2;	/* number of codes of colorings of R */
-      for (i = 0; i < ncodes; i++)
-	 live[i] = 1;
-      nlive = findlive(live, ncodes, angle, power, graph[0][2]);
-      /* "findlive" computes {\cal C}_0 and stores in live */
-      nchar = simatchnumber[ring] / 8 + 1;
-      for (i = 0; i <= nchar; i++)
-	 real[i] = (char) 255;
-      /* "real" will be an array of characters, and each bit of each
-       * character will correspond to a balanced signed matching. At this
-       * stage all the bits are set = 1. */
-      do
-	 testmatch(ring, real, power, live, nchar);
-      /* computes {\cal M}_{i+1} from {\cal M}_i, updates the bits of "real" */
-      while (updatelive(live, ncodes, &nlive));
-      /* computes {\cal C}_{i+1} from {\cal C}_i, updates "live" */
-      checkcontract(live, nlive, diffangle, sameangle, contract, power);
-      /* This verifies that the set claimed to be a contract for the
-       * configuration really is. */
-   }
-   (void) fclose(fp);
-   free(live);
-   free(real);
-   (void) printf("Reducibility of %ld configurations verified\n", count);
+   if (opts.results != NULL) {
+      (void) fprintf(opts.results, "total %ld %ld\n", in.nseen, count);
+      (void) fclose(opts.results);
+   }
+   if (in.nshards == 1 && !select)
+      (void) printf("Reducibility of %ld configurations verified\n", count);
+   else if (in.nshards == 1)
+      (void) printf("Reducibility of %ld of the %ld configurations verified\n", count, in.nseen);
+   else
+      (void) printf("Shard %ld/%ld: reducibility of %ld of the %ld configurations verified\n", in.shard, in.nshards, count, in.nseen);
    return (0);
 }
 
 
 void
-testmatch(ring, real, power, live, nchar)
-long ring, power[], nchar;
-char *live, *real;
+testconf(J, W, power)
+tp_job *J;
+tp_work *W;
+long power[];
 
-/* This generates all balanced signed matchings, and for each one, tests
- * whether all associated colourings belong to "live". It writes the answers
- * in the bits of the characters of "real". */
+/* Verifies that the configuration J->graph is reducible, using the scratch
+ * space in W; "ReadJob" has filled in the rest of J. All output goes to
+ * J->out; if some check fails, the message is written there and "Fail" is
+ * called. */
 {
-   long a, b, n, interval[10], *weight[8], nreal;
-   long matchweight[MAXRING + 1][MAXRING + 1][4], *mw, realterm; // jps
-   char bit;
-
-   nreal = 0;
-   /* "nreal" will be the number of balanced signed matchings such that all
-    * associated colourings belong to "live"; ie the total number of nonzero
-    * bits in the entries of "real" */
-   bit = 1;
-   realterm = 0;
-   /* First, it generates the matchings not incident with the last ring edge */
+   long ring, nlive, ncodes, i, nchar, more, compact;
+   char *live, *real;
+   tp_survivors *K;
+   tp_table *T;
 
-   for (a = 2; a <= ring; a++)
-      for (b = 1; b < a; b++) {
-	 mw = matchweight[a][b];
-	 mw[0] = 2 * (power[a] + power[b]);
-	 mw[1] = 2 * (power[a] - power[b]);
-	 mw[2] = power[a] + power[b];
-	 mw[3] = power[a] - power[b];
+   ring = J->graph[0][1];	/* ring-size */
+   if (!roomfor(W, ring, power)) {
+      (void) fprintf(J->out, "Not enough memory for ring-size %ld\n", ring);
+      Fail(J, (long) 44);
+   }
+   live = W->live;
+   real = W->real;
+   ncodes = (power[ring] + 1) / 2;	/* number of codes of colorings of R */
+   (void) memset(live, 0x11, (size_t) (ncodes + 1) / 2);
+   if (ncodes & 1)
+      live[ncodes >> 1] = 1;
+   /* "live" holds 4 bits for each code, two codes to a character, the
+    * lower half for the even code; LIVE(live, i) gives those of code i.
+    * Bit 1 says that the colouring is still live, and "stillreal" sets the
+    * other three, which "updatelive" then folds back into bit 1. At this
+    * stage all the colourings are live, and any half that is not a code is
+    * 0. */
+   J->split = splitting(W, ring);
+   nlive = findlive(live, ncodes, J->angle, power, J->graph[0][2], J);
+   /* "findlive" computes {\cal C}_0 and stores in live */
+   J->extent = ncodes - nlive;
+   nchar = matchnumber(ring) / 8 + 1;
+   for (i = 0; i <= nchar; i++)
+      real[i] = (char) 255;
+   /* "real" will be an array of characters, and each bit of each
+    * character will correspond to a balanced signed matching. At this
+    * stage all the bits are set = 1. */
+   J->iterations = 0;
+   W->sparse.n = -1;	/* "live" starts dense */
+   K = keeping(W, ring);
+   T = OpenTable(ring);
+   J->expand = OpenExpand(ring, power);
+   compact = 0;
+   do {
+      J->split = splitting(W, ring);
+      if (compact && worklist && (i = fixlive(ring, real, power, live, ncodes, &nlive, K, J)) >= 0)
+	 more = 0;	/* the last {\cal M}_i and {\cal C}_i, in one go */
+      else {
+	 if (compact)
+	    i = survivematch(ring, real, power, live, K, J);
+	 else {
+	    J->survivors = K;
+	    if (K != NULL)
+	       K->n = K->full = 0;
+	    if (J->split > 1)
+	       i = splitmatch(ring, real, power, live, nchar, T, J);
+	    else if (T != NULL)
+	       i = tablematch(ring, real, power, live, nchar, T, J);
+	    else
+	       i = testmatch(ring, real, power, live, nchar, J);
+	    J->survivors = NULL;
+	    compact = K != NULL && !K->full;
+	 }
+	 /* computes {\cal M}_{i+1} from {\cal M}_i, updates the bits of
+	  * "real"; once the matchings left all fit in K, only they are
+	  * looked at */
+	 more = updatelive(live, ncodes, &nlive, &W->sparse, J);
+	 /* computes {\cal C}_{i+1} from {\cal C}_i, updates "live" */
       }
-   for (a = 2; a < ring; a++)
-      for (b = 1; b < a; b++) {
-	 n = 0;
-	 weight[1] = matchweight[a][b];
-	 if (b >= 3) {
-	    n = 1;
-	    interval[1] = 1;
-	    interval[2] = b - 1;
+      if (J->iterations < MAXITER) {
+	 J->trace[2 * J->iterations] = i;
+	 J->trace[2 * J->iterations + 1] = nlive;
+      }
+      J->iterations++;
+   } while (more);
+   J->nlive = nlive;
+   checkcontract(live, nlive, J->diffangle, J->sameangle, J->contract, power, J);
+   /* This verifies that the set claimed to be a contract for the
+    * configuration really is. */
+}
+
+
+long
+splitting(W, ring)
+tp_work *W;
+long ring;
+
+/* Returns the number of threads among which to split the work on a
+ * configuration of the given ring-size: 1 plus the number of idle workers
+ * of "-j" from SPLITRING on, and 1 otherwise */
+{
+   if (W->pool == NULL || ring < SPLITRING)
+      return ((long) 1);
+   return (1 + W->pool->opts->nthreads - __atomic_load_n(&W->pool->nbusy, __ATOMIC_RELAXED));
+}
+
+
+long
+verify(J, W, power, O)
+tp_job *J;
+tp_work *W;
+long power[];
+tp_opts *O;
+
+/* Runs "testconf" on J, unless it is isomorphic to an earlier configuration
+ * (see "Isomorph"), or the journal (if any) says that an earlier run did it,
+ * or the cache (if any) has its results, which are then printed instead;
+ * records the processor time it takes in J->seconds. Returns 0 if
+ * the configuration is reducible, and otherwise the exit status that was
+ * passed to "Fail". */
+{
+   long status;
+   char *entry, text[CONFTEXT];
+   struct timespec t0, t1;
+   tp_journal *L;
+   tp_cache *C;
+
+   L = O->journal;
+   C = O->cache;
+   J->iterations = 0;
+   J->folds[0] = '\0';	/* in case none are run */
+   if (L != NULL || C != NULL)
+      ConfText(J->graph, text);
+   (void) clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+   if ((status = setjmp(J->abort)) == 0) {
+      if (J->original >= 0)
+	 (void) fprintf(J->out, "\n   Configuration %ld is isomorphic to configuration %ld.\n\n", J->number + 1, J->original + 1);
+      else if (L == NULL || !Journaled(J, L, text)) {
+	 entry = C != NULL ? Cached(J, C, text) : NULL;
+	 if (entry != NULL && !Resample(J, C) && Replay(J, entry, power))
+	    __atomic_fetch_add(&C->hits, (long) 1, __ATOMIC_RELAXED);
+	 else {
+	    testconf(J, W, power);
+	    if (C != NULL)
+	       CacheAdd(J, C, entry, text);
 	 }
-	 if (a >= b + 3) {
-	    n++;
-	    interval[2 * n - 1] = b + 1;
-	    interval[2 * n] = a - 1;
+	 if (L != NULL)
+	    JournalAdd(J, L, text);
+      }
+   }
+   (void) clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+   J->seconds = (t1.tv_sec - t0.tv_sec) + 1e-9 * (t1.tv_nsec - t0.tv_nsec);
+   return (status);
+}
+
+
+long
+ReadJob(J, I)
+tp_job *J;
+tp_input *I;
+
+/* Reads the next configuration of I that belongs to its shard (and has been
+ * selected) into J->graph, passing over the others without looking inside
+ * them, or with an index seeking straight to it, and computes the rest of
+ * J from it. Returns 0 if successful, 1 on end of
+ * file, and otherwise the exit status passed to "Fail" by "ReadConf" or
+ * "findangles", whose message is then in J->out. */
+{
+   long status;
+
+   if (I->offset != NULL) {
+      for (; I->nseen < I->nindex; I->nseen++)
+	 if (I->nseen % I->nshards == I->shard - 1 && I->nseen >= I->first && (I->last < 0 || I->nseen <= I->last)
+	     && (!I->ringsize || I->rings[I->nseen] == I->ringsize))
+	    break;
+      if (I->nseen == I->nindex || fseek(I->fp, I->offset[I->nseen], SEEK_SET))
+	 return ((long) 1);
+   } else
+      while (I->nseen % I->nshards != I->shard - 1) {
+	 if (SkipConf(I->fp))
+	    return ((long) 1);
+	 I->nseen++;
+      }
+   J->number = I->nseen;
+   if ((status = setjmp(J->abort)) == 0) {
+      status = ReadConf(J->graph, I->fp, (long *) NULL, J);
+      if (status == 0) {
+	 I->nseen++;
+	 J->hash = ConfHash(J->graph);
+	 findangles(J->graph, J->angle, J->diffangle, J->sameangle, J->contract, J);
+	 /* "findangles" fills in the arrays "angle","diffangle","sameangle"
+	  * and "contract" from the input "graph". "angle" will be used to
+	  * compute which colourings of the ring edges extend to the
+	  * configuration; the others will not be used unless a contract is
+	  * specified, and if so they will be used in "checkcontract" to
+	  * verify that the contract is correct. */
+	 if (J->graph[0][1] > MAXRING) {
+	    (void) fprintf(J->out, "Ring-size bigger than %d\n", MAXRING);
+	    Fail(J, (long) 43);
 	 }
-	 augment(n, interval, (long) 1, weight, matchweight, live, real, &nreal, ring, (long) 0, (long) 0, &bit, &realterm, nchar);
+	 J->original = I->dedup ? Isomorph(J, I) : -1;
       }
+   } else if (J->number == I->nseen)	/* "ReadConf" failed */
+      I->nseen++;
+   return (status);
+}
 
-   /* now, the matchings using an edge incident with "ring" */
-   for (a = 2; a <= ring; a++)
-      for (b = 1; b < a; b++) {
-	 mw = matchweight[a][b];
-	 mw[0] = power[a] + power[b];
-	 mw[1] = power[a] - power[b];
-	 mw[2] = -power[a] - power[b];
-	 mw[3] = -power[a] - 2 * power[b];
+
+long
+SkipConf(F)
+FILE *F;
+
+/* Reads past the next configuration in F, which ends at a blank line as in
+ * "ReadConf". Returns 1 if there is none, and 0 otherwise. */
+{
+   char S[256], *t;
+
+   do {
+      if (fgets(S, sizeof(S), F) == NULL)
+	 return ((long) 1);
+      for (t = S; *t == ' ' || *t == '\t'; t++);
+   } while (*t == '\n' || *t == '\0');
+   do {
+      if (fgets(S, sizeof(S), F) == NULL)
+	 return ((long) 0);
+      for (t = S; *t == ' ' || *t == '\t'; t++);
+   } while (*t != '\n' && *t != '\0');
+   return ((long) 0);
+}
+
+
+void
+Fail(J, status)
+tp_job *J;
+long status;
+
+/* Abandons the configuration J with the given exit status; see "verify" and
+ * "ReadJob". Without a configuration it exits straight away. */
+{
+   if (J == NULL)
+      exit((int) status);
+   (void) fflush(J->out);
+   longjmp(J->abort, (int) status);
+}
+
+
+tp_work *
+NewWork()
+
+/* Allocates the scratch space needed to verify one configuration at a
+ * time; "roomfor" then makes it big enough for each configuration */
+{
+   long i;
+   tp_work *W;
+
+   W = (tp_work *) malloc(sizeof(tp_work));
+   if (W == NULL) {
+      (void) printf("Not enough memory.\n");
+      exit(44);
+   }
+   W->live = W->real = NULL;
+   W->ring = 0;
+   for (i = 0; i < SURVIVORCHUNKS; i++)
+      W->kept.chunk[i] = NULL;
+   W->kept.n = W->kept.max = W->kept.words = W->kept.stride = 0;
+   W->sparse.code = NULL;
+   W->sparse.max = 0;
+   W->pool = NULL;
+   return (W);
+}
+
+
+long
+roomfor(W, ring, power)
+tp_work *W;
+long ring, power[];
+
+/* Makes "live" and "real" of W big enough for the given ring-size, unless
+ * they are already. They only grow, so they end up the size needed by the
+ * largest ring-size among the configurations verified with W, rather than
+ * by MAXRING. Returns 0 if there is not enough memory, and 1 otherwise. */
+{
+   char *live, *real;
+
+   if (ring <= W->ring)
+      return ((long) 1);
+   live = BigAlloc(((power[ring] + 1) / 2 + 1) / 2 + 3);	/* see "stillgather" */
+   real = BigAlloc(matchnumber(ring) / 8 + 2);
+   if (live == NULL || real == NULL) {
+      BigFree(live, ((power[ring] + 1) / 2 + 1) / 2 + 3);
+      BigFree(real, matchnumber(ring) / 8 + 2);
+      return ((long) 0);
+   }
+   if (W->ring) {
+      BigFree(W->live, ((power[W->ring] + 1) / 2 + 1) / 2 + 3);
+      BigFree(W->real, matchnumber(W->ring) / 8 + 2);
+   }
+   W->live = live;
+   W->real = real;
+   W->ring = ring;
+   return ((long) 1);
+}
+
+
+void
+FreeWork(W, power)
+tp_work *W;
+long power[];
+
+/* Frees W and all its space */
+{
+   long i;
+
+   if (W->ring) {
+      BigFree(W->live, ((power[W->ring] + 1) / 2 + 1) / 2 + 3);
+      BigFree(W->real, matchnumber(W->ring) / 8 + 2);
+   }
+   for (i = 0; i < SURVIVORCHUNKS; i++)
+      free(W->kept.chunk[i]);
+   free(W->sparse.code);
+   free(W);
+}
+
+
+char *
+BigAlloc(size)
+long size;
+
+/* Returns space for size characters of "live" or "real", or NULL if there
+ * is not enough. With "--spill" it is in a file of that directory, removed
+ * at once, so that it can be paged out to the file; with "--huge" it is
+ * mapped so that it may be in huge pages; and otherwise it comes from
+ * malloc. */
+{
+   long fd;
+   char *name, *p;
+
+   if (spilldir != NULL) {
+      name = (char *) malloc(strlen(spilldir) + 16);
+      if (name == NULL)
+	 return ((char *) NULL);
+      (void) sprintf(name, "%s/reduceXXXXXX", spilldir);
+      fd = mkstemp(name);
+      if (fd >= 0)
+	 (void) unlink(name);
+      free(name);
+      if (fd < 0)
+	 return ((char *) NULL);
+      p = ftruncate((int) fd, (off_t) size) ? MAP_FAILED : (char *) mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_SHARED, (int) fd, 0);
+      (void) close((int) fd);
+      return (p == MAP_FAILED ? (char *) NULL : p);
+   }
+   if (hugepages) {
+      p = (char *) mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED)
+	 return ((char *) NULL);
+#ifdef MADV_HUGEPAGE
+      (void) madvise((void *) p, (size_t) size, MADV_HUGEPAGE);
+#endif
+      return (p);
+   }
+   return ((char *) malloc((size_t) size));
+}
+
+
+void
+BigFree(p, size)
+char *p;
+long size;
+
+/* Frees space of the given size from "BigAlloc" */
+{
+   if (p == NULL)
+      return;
+   if (spilldir != NULL || hugepages)
+      (void) munmap((void *) p, (size_t) size);
+   else
+      free(p);
+}
+
+
+double
+predictcost(graph, power)
+tp_confmat graph;
+long power[];
+
+/* Estimates the processor time in seconds that "testconf" will take on
+ * "graph". Nearly all of it goes into the iterations of "testmatch", which
+ * visits each of the matchnumber(ring) balanced signed matchings, and of
+ * "updatelive", which sweeps the (3^(ring-1)+1)/2 codes; the number of
+ * iterations grows roughly linearly with the ring-size. "findlive" takes
+ * time proportional to the number of edges (as computed in "findangles")
+ * times the number of colourings that extend. The coefficients were fitted
+ * to the times reported by "--costs" for a sample of U_2822.conf. */
+{
+   long ring, edges;
+   double iterations;
+
+   ring = graph[0][1];
+   edges = 3 * graph[0][0] - 3 - ring;
+   if (ring < 2 || ring > MAXRING || edges >= EDGES)
+      return (0.0);	/* it will be rejected straight away */
+   iterations = 1.0 + 0.8 * (ring - 4);
+   return (iterations * (1.4e-8 * matchnumber(ring) + 2.0e-9 * ((power[ring] + 1) / 2))
+      + 1.1e-9 * edges * graph[0][2]);
+}
+
+
+void
+PrintCost(J, F)
+tp_job *J;
+FILE *F;
+
+/* Writes a line of the "--costs" report about J into F. Its last field has
+ * a letter for each iteration run, telling how "live" was updated: d if
+ * dense, s if as a list (see "updatelive"), w by "fixlive"; or it is - if
+ * none were run. */
+{
+   long ring, verts, n;
+
+   verts = J->graph[0][0];
+   ring = J->graph[0][1];
+   n = J->iterations < MAXITER ? J->iterations : MAXITER;
+   J->folds[n] = '\0';
+   (void) fprintf(F, "%6ld %4ld %5ld %5ld %10.4f %10.4f %s\n", J->number + 1, ring, 3 * verts - 3 - ring, verts, J->cost, J->seconds,
+      n > 0 && J->folds[0] ? J->folds : "-");
+   (void) fflush(F);
+}
+
+
+void
+PrintResult(J, O, power)
+tp_job *J;
+tp_opts *O;
+long power[];
+
+/* Called for each configuration, in input order, once it is done. Writes
+ * its lines of the "--costs" and "--result" files. */
+{
+   if (O->costs != NULL && J->seconds >= 0.0) {
+      if (J->cost == 0.0)
+	 J->cost = predictcost(J->graph, power);
+      PrintCost(J, O->costs);
+   }
+   if (O->results != NULL) {
+      (void) fprintf(O->results, "%ld %ld\n", J->number + 1, J->status);
+      (void) fflush(O->results);
+   }
+}
+
+
+long
+RunSerial(I, power, O)
+tp_input *I;
+long power[];
+tp_opts *O;
+
+/* Verifies the configurations of I one after another, writing to stdout
+ * as it goes. Returns the number of configurations. */
+{
+   long count, status;
+   static tp_job job;
+   tp_work *W;
+
+   W = NewWork();
+   job.out = stdout;
+   for (count = 0; !(status = ReadJob(&job, I)); count++) {
+      job.status = verify(&job, W, power, O);
+      job.cost = 0.0;
+      PrintResult(&job, O, power);
+      if (job.status)
+	 exit((int) job.status);
+   }
+   if (status != 1) {
+      job.status = status;
+      job.seconds = -1.0;
+      PrintResult(&job, O, power);
+      exit((int) status);
+   }
+   FreeWork(W, power);
+   return (count);
+}
+
+
+long
+RunParallel(I, power, O)
+tp_input *I;
+long power[];
+tp_opts *O;
+
+/* Same as "RunSerial", but O->nthreads workers verify configurations at the
+ * same time. The output of each configuration is kept until that of all
+ * earlier ones has been written, so stdout is the same as for "RunSerial".
+ * Normally a separate thread reads configurations ahead of the workers;
+ * with O->schedule they are all read first and handed out by decreasing
+ * predicted cost, so that the run does not end waiting for one large ring. */
+{
+   long i, j, status, nthreads;
+   tp_pool pool;
+   tp_job *J;
+   tp_work **W;
+   pthread_t *thread, reader;
+
+   nthreads = O->nthreads;
+   pool.in = I;
+   pool.power = power;
+   pool.opts = O;
+   pool.nread = pool.ndispatched = pool.nprinted = pool.eof = pool.nbusy = 0;
+   pool.order = NULL;
+   if (O->schedule) {
+      (void) ReadAll(&pool);
+      pool.order = (long *) malloc((pool.nread + 1) * sizeof(long));
+      if (pool.order == NULL) {
+	 (void) printf("Not enough memory to schedule %ld configurations.\n", pool.nread);
+	 exit(44);
       }
-   for (b = 1; b < ring; b++) {
-      n = 0;
-      weight[1] = matchweight[ring][b];
-      if (b >= 3) {
-	 n = 1;
-	 interval[1] = 1;
-	 interval[2] = b - 1;
+      for (i = 0; i < pool.nread; i++) {
+	 J = pool.jobs[i];
+	 J->cost = J->status || J->original >= 0 ? 0.0 : predictcost(J->graph, power);
+	 /* insertion sort by decreasing cost, ties in input order */
+	 for (j = i; j > 0 && pool.jobs[pool.order[j - 1]]->cost < J->cost; j--)
+	    pool.order[j] = pool.order[j - 1];
+	 pool.order[j] = i;
       }
-      if (ring >= b + 3) {
-	 n++;
-	 interval[2 * n - 1] = b + 1;
-	 interval[2 * n] = ring - 1;
+   } else {
+      pool.window = MAXJOBS * nthreads;
+      pool.jobs = (tp_job **) malloc(pool.window * sizeof(tp_job *));
+      for (i = 0; pool.jobs != NULL && i < pool.window; i++)
+	 if ((pool.jobs[i] = (tp_job *) malloc(sizeof(tp_job))) != NULL)
+	    pool.jobs[i]->done = 0;
+	 else
+	    pool.jobs = NULL;
+      if (pool.jobs == NULL) {
+	 (void) printf("Not enough memory for %ld threads.\n", nthreads);
+	 exit(44);
+      }
+   }
+   W = (tp_work **) malloc(nthreads * sizeof(tp_work *));
+   thread = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+   if (W == NULL || thread == NULL) {
+      (void) printf("Not enough memory for %ld threads.\n", nthreads);
+      exit(44);
+   }
+   (void) pthread_mutex_init(&pool.lock, NULL);
+   (void) pthread_cond_init(&pool.progress, NULL);
+   for (i = 0; i < nthreads; i++) {
+      W[i] = NewWork();
+      W[i]->pool = &pool;
+   }
+   if (!O->schedule && pthread_create(&reader, NULL, producer, (void *) &pool)) {
+      (void) printf("Can't start reading thread\n");
+      exit(45);
+   }
+   for (i = 0; i < nthreads; i++)
+      if (pthread_create(&thread[i], NULL, worker, (void *) W[i])) {
+	 (void) printf("Can't start thread %ld\n", i + 1);
+	 exit(45);
+      }
+
+   /* Print the configurations in the order in which they were read */
+   (void) pthread_mutex_lock(&pool.lock);
+   for (;;) {
+      J = pool.jobs[pool.nprinted % pool.window];
+      if (pool.nprinted < __atomic_load_n(&pool.nread, __ATOMIC_ACQUIRE) && J->done) {
+	 (void) pthread_mutex_unlock(&pool.lock);
+	 (void) fwrite(J->text, sizeof(char), J->size, stdout);
+	 (void) fflush(stdout);
+	 free(J->text);
+	 PrintResult(J, O, power);
+	 if (J->status)
+	    exit((int) J->status);
+	 (void) pthread_mutex_lock(&pool.lock);
+	 J->done = 0;
+	 __atomic_store_n(&pool.nprinted, pool.nprinted + 1, __ATOMIC_RELEASE);
+      } else if (__atomic_load_n(&pool.eof, __ATOMIC_ACQUIRE) && pool.nprinted == __atomic_load_n(&pool.nread, __ATOMIC_ACQUIRE))
+	 break;
+      else
+	 (void) pthread_cond_wait(&pool.progress, &pool.lock);
+   }
+   (void) pthread_mutex_unlock(&pool.lock);
+   if (!O->schedule)
+      (void) pthread_join(reader, NULL);
+   for (i = 0; i < nthreads; i++)
+      (void) pthread_join(thread[i], NULL);
+   for (i = 0; i < nthreads; i++)
+      FreeWork(W[i], power);
+   status = pool.nread;
+   (void) pthread_cond_destroy(&pool.progress);
+   (void) pthread_mutex_destroy(&pool.lock);
+   for (i = 0; i < (O->schedule ? pool.nread : pool.window); i++)
+      free(pool.jobs[i]);
+   free(pool.jobs);
+   if (pool.order != NULL)
+      free(pool.order);
+   free(W);
+   free(thread);
+   return (status);
+}
+
+
+void *
+producer(arg)
+void *arg;
+
+/* The reading thread of "RunParallel". It parses and checks each
+ * configuration with "ReadJob" as soon as there is a free entry in the
+ * window, so that workers never wait for the input. */
+{
+   long i, status, spins;
+   tp_pool *P;
+   tp_job *J;
+
+   P = (tp_pool *) arg;
+   for (i = 0;; i++) {
+      for (spins = 0; i - __atomic_load_n(&P->nprinted, __ATOMIC_ACQUIRE) >= P->window;)
+	 Pause(&spins);
+      J = P->jobs[i % P->window];
+      J->status = 0;
+      J->cost = 0.0;
+      J->out = open_memstream(&J->text, &J->size);
+      if (J->out == NULL) {
+	 (void) printf("Not enough memory for the output of configuration %ld\n", P->in->nseen + 1);
+	 exit(44);
+      }
+      status = ReadJob(J, P->in);
+      if (status == 1) {	/* end of file */
+	 (void) fclose(J->out);
+	 free(J->text);
+	 break;
+      }
+      if (status) {	/* a worker will pass it over; nothing more is read */
+	 (void) fclose(J->out);
+	 J->status = status;
+	 J->seconds = -1.0;
+	 (void) pthread_mutex_lock(&P->lock);
+	 J->done = 1;
+	 (void) pthread_mutex_unlock(&P->lock);
+	 __atomic_store_n(&P->nread, i + 1, __ATOMIC_RELEASE);
+	 break;
+      }
+      __atomic_store_n(&P->nread, i + 1, __ATOMIC_RELEASE);
+   }
+   __atomic_store_n(&P->eof, 1, __ATOMIC_RELEASE);
+   (void) pthread_mutex_lock(&P->lock);
+   (void) pthread_cond_broadcast(&P->progress);
+   (void) pthread_mutex_unlock(&P->lock);
+   return (NULL);
+}
+
+
+long
+ReadAll(P)
+tp_pool *P;
+
+/* Reads all configurations of P->in into P->jobs, stopping after the first
+ * one that cannot be read; P->window becomes the number of entries of
+ * P->jobs, and P->nread the number of them used. Returns P->nread. Each
+ * job is allocated on its own, because its output stream points into it
+ * and so it must not move when P->jobs grows. */
+{
+   long status;
+   tp_job *J;
+
+   P->window = 64;
+   P->jobs = (tp_job **) malloc(P->window * sizeof(tp_job *));
+   for (status = 0, J = NULL; P->jobs != NULL && !status; P->nread++) {
+      if (P->nread == P->window) {
+	 P->window *= 2;
+	 P->jobs = (tp_job **) realloc(P->jobs, P->window * sizeof(tp_job *));
+	 if (P->jobs == NULL)
+	    break;
+      }
+      J = P->jobs[P->nread] = (tp_job *) malloc(sizeof(tp_job));
+      if (J == NULL)
+	 break;
+      J->done = 0;
+      J->status = 0;
+      J->cost = 0.0;
+      J->out = open_memstream(&J->text, &J->size);
+      if (J->out == NULL)
+	 break;
+      status = ReadJob(J, P->in);
+      if (status == 1) {	/* end of file */
+	 (void) fclose(J->out);
+	 free(J->text);
+	 free(J);
+	 break;
+      }
+      if (status) {
+	 (void) fclose(J->out);
+	 J->status = status;
+	 J->seconds = -1.0;
+	 J->done = 1;
+      }
+   }
+   if (P->jobs == NULL || J == NULL || (status == 0 && J->out == NULL)) {
+      (void) printf("Not enough memory to read configuration %ld.\n", P->nread + 1);
+      exit(44);
+   }
+   P->eof = 1;
+   return (P->nread);
+}
+
+
+void *
+worker(arg)
+void *arg;
+
+/* The body of each verifying thread of "RunParallel". It claims the next
+ * configuration of the queue, waiting for "producer" if need be, verifies
+ * it into its buffer with no lock held, and then tells "RunParallel" that
+ * it can be printed. */
+{
+   long i, status, spins;
+   tp_work *W;
+   tp_pool *P;
+   tp_job *J;
+
+   W = (tp_work *) arg;
+   P = W->pool;
+   for (;;) {
+      i = __atomic_fetch_add(&P->ndispatched, 1, __ATOMIC_ACQ_REL);
+      for (spins = 0; i >= __atomic_load_n(&P->nread, __ATOMIC_ACQUIRE); Pause(&spins))
+	 if (__atomic_load_n(&P->eof, __ATOMIC_ACQUIRE) && i >= __atomic_load_n(&P->nread, __ATOMIC_ACQUIRE))
+	    return (NULL);
+      J = P->jobs[P->order != NULL ? P->order[i] : i % P->window];
+      if (J->status)	/* it could not be read */
+	 continue;
+      (void) __atomic_fetch_add(&P->nbusy, (long) 1, __ATOMIC_RELAXED);
+      status = verify(J, W, P->power, P->opts);
+      (void) __atomic_fetch_sub(&P->nbusy, (long) 1, __ATOMIC_RELAXED);
+      (void) fclose(J->out);
+      (void) pthread_mutex_lock(&P->lock);
+      J->status = status;
+      J->done = 1;
+      (void) pthread_cond_broadcast(&P->progress);
+      (void) pthread_mutex_unlock(&P->lock);
+   }
+}
+
+
+void
+Pause(pspins)
+long *pspins;
+
+/* Waits for another thread a little, longer after many calls in a row */
+{
+   struct timespec t;
+
+   if (++*pspins < 100) {
+      (void) sched_yield();
+      return;
+   }
+   t.tv_sec = 0;
+   t.tv_nsec = *pspins < 1000 ? 10000 : 1000000;
+   (void) nanosleep(&t, NULL);
+}
+
+
+unsigned long
+ConfHash(A)
+tp_confmat A;
+
+/* Returns a hash value of the configuration A as read by "ReadConf",
+ * including the claimed number of extendable colourings and the contract.
+ * Only the entries of row 0 that "ReadConf" fills are used; the others
+ * are left over from whatever configuration was read before. */
+{
+   long i;
+   unsigned long h;
+
+   h = Hash((unsigned long) HASHINIT, (char *) A[0], (2 * A[0][4] + 5) * (long) sizeof(long));
+   for (i = 1; i <= A[0][0]; i++)
+      h = Hash(h, (char *) A[i], (A[i][0] + 1) * (long) sizeof(long));
+   return (h);
+}
+
+
+void
+ConfText(A, S)
+tp_confmat A;
+char *S;
+
+/* Writes into S the entries of A that "ConfHash" covers, as numbers
+ * separated by spaces, with a comma before each row after row 0. The
+ * journal and the cache keep it, so that a result is only trusted for
+ * exactly the configuration it was found for, whatever the hash value. */
+{
+   long i, j, n;
+
+   for (i = 0; i <= A[0][0]; i++) {
+      n = i ? A[i][0] + 1 : 2 * A[0][4] + 5;
+      for (j = 0; j < n; j++)
+	 S += sprintf(S, j ? " %ld" : i ? ",%ld" : "%ld", A[i][j]);
+   }
+}
+
+
+long
+Isomorph(J, I)
+tp_job *J;
+tp_input *I;
+
+/* Returns the number of the first configuration read from I that is
+ * isomorphic to J, that is, has the same "canonical" form, or -1 if there
+ * is none, in which case J is added to those of I (see "canonfind") */
+{
+   return (canonfind(&I->canon, J->graph, J->number));
+}
+
+
+void
+OpenIndex(I, name, rebuild)
+tp_input *I;
+char name[];
+long rebuild;
+
+/* Loads into I the index of the configuration file "name", which is open as
+ * I->fp. The index is kept in the file name.idx; it is made afresh in one
+ * pass over I->fp if it is missing or out of date, or if "rebuild" is
+ * nonzero. It consists of a line
+ *	index <size> <hash> <number of configurations>
+ * about the configuration file, where hash is its "HashFile", so that an
+ * index is only used for exactly the file it was made for; followed by a
+ * line
+ *	<number> <offset> <ring-size>
+ * for each configuration, where offset is the position of its first line
+ * in the file. The "GetConf" of discharge.c reads it too. */
+{
+   long i;
+   unsigned long hash;
+   char *idxname;
+   struct stat st;
+   FILE *F;
+
+   idxname = (char *) malloc(strlen(name) + 5);
+   if (idxname == NULL) {
+      (void) printf("Not enough memory for the index\n");
+      exit(44);
+   }
+   (void) sprintf(idxname, "%s.idx", name);
+   if (fstat(fileno(I->fp), &st)) {
+      (void) printf("Can't find the size of %s\n", name);
+      exit(1);
+   }
+   hash = HashFile(I->fp);
+   if (rebuild || !LoadIndex(I, idxname, &st, hash)) {
+      MakeIndex(I);
+      F = fopen(idxname, "w");
+      if (F == NULL && rebuild) {
+	 (void) printf("Can't open %s\n", idxname);
+	 exit(1);
+      }
+      if (F != NULL) {	/* otherwise it is only kept for this run */
+	 (void) fprintf(F, "index %ld %016lx %ld\n", (long) st.st_size, hash, I->nindex);
+	 for (i = 0; i < I->nindex; i++)
+	    (void) fprintf(F, "%ld %ld %ld\n", i + 1, I->offset[i], I->rings[i]);
+	 (void) fclose(F);
+      }
+   }
+   free(idxname);
+}
+
+
+long
+LoadIndex(I, idxname, st, hash)
+tp_input *I;
+char idxname[];
+struct stat *st;
+unsigned long hash;
+
+/* Reads the index in the file "idxname" into I, if it describes the
+ * configuration file with status st and "HashFile" hash. Returns 1 if
+ * successful, 0 otherwise. */
+{
+   long n, size, number, offset, ring;
+   unsigned long h;
+   char S[256];
+   FILE *F;
+
+   F = fopen(idxname, "r");
+   if (F == NULL)
+      return ((long) 0);
+   if (fgets(S, sizeof(S), F) == NULL || sscanf(S, "index %ld %lx %ld", &size, &h, &n) != 3
+       || size != (long) st->st_size || h != hash)
+      n = -1;
+   for (I->nindex = 0; I->nindex < n && fgets(S, sizeof(S), F) != NULL;) {
+      if (sscanf(S, "%ld %ld %ld", &number, &offset, &ring) != 3 || number != I->nindex + 1)
+	 break;
+      IndexAdd(I, offset, ring);
+   }
+   (void) fclose(F);
+   if (I->nindex == n)
+      return ((long) 1);
+   I->nindex = 0;
+   return ((long) 0);
+}
+
+
+void
+MakeIndex(I)
+tp_input *I;
+
+/* Finds where each configuration of I->fp starts, as in "SkipConf", and
+ * its ring-size, and stores them in I; then rewinds I->fp. */
+{
+   long inconf, offset, verts, ring;
+   char S[256], *t;
+
+   rewind(I->fp);
+   I->nindex = 0;
+   for (inconf = 0, offset = 0; fgets(S, sizeof(S), I->fp) != NULL; offset = ftell(I->fp)) {
+      for (t = S; *t == ' ' || *t == '\t'; t++);
+      if (*t == '\n' || *t == '\0')
+	 inconf = 0;
+      else if (!inconf) {	/* the name of the next configuration */
+	 inconf = 1;
+	 if (fgets(S, sizeof(S), I->fp) == NULL || sscanf(S, "%ld%ld", &verts, &ring) != 2)
+	    ring = 0;	/* "ReadConf" will complain */
+	 IndexAdd(I, offset, ring);
+      }
+   }
+   rewind(I->fp);
+}
+
+
+void
+IndexAdd(I, offset, ring)
+tp_input *I;
+long offset, ring;
+
+/* Appends an entry to the index of I */
+{
+   if ((I->nindex & (I->nindex - 1)) == 0) {	/* 0 or a power of 2 */
+      I->offset = (long *) realloc(I->offset, 2 * (I->nindex + 1) * sizeof(long));
+      I->rings = (long *) realloc(I->rings, 2 * (I->nindex + 1) * sizeof(long));
+      if (I->offset == NULL || I->rings == NULL) {
+	 (void) printf("Not enough memory for the index\n");
+	 exit(44);
+      }
+   }
+   I->offset[I->nindex] = offset;
+   I->rings[I->nindex++] = ring;
+}
+
+
+tp_journal *
+OpenJournal(name, resume)
+char name[];
+long resume;
+
+/* Opens the journal called "name" for appending. If "resume" is nonzero the
+ * configurations recorded in it are loaded first; otherwise it is emptied.
+ * A journal consists of lines
+ *	conf <number> <hash> <nlive> <iterations> <D or C> <text>
+ * one for each configuration verified; the field after the iterations
+ * tells if it is D-reducible, or C-reducible with the given contract, and
+ * text is its "ConfText". A last line that was cut short when a run was
+ * killed is ignored, and cut off the file so that the next line does not
+ * run on from it. Lines without the text, from older versions, are
+ * ignored too, so those configurations are verified again. */
+{
+   long number, nlive, iterations, end, n;
+   unsigned long h;
+   char S[64 + CONFTEXT], verdict;
+   tp_journal *L;
+   FILE *F;
+
+   L = (tp_journal *) malloc(sizeof(tp_journal));
+   if (L == NULL) {
+      (void) printf("Not enough memory for the journal\n");
+      exit(44);
+   }
+   L->size = 0;
+   L->proven = NULL;
+   L->hash = NULL;
+   L->text = NULL;
+   if (resume && (F = fopen(name, "r")) != NULL) {
+      for (end = 0; fgets(S, sizeof(S), F) != NULL;) {
+	 if (strchr(S, '\n') != NULL)
+	    end = ftell(F);	/* where the last whole line ends */
+	 if (strchr(S, '\n') == NULL || sscanf(S, "conf %ld %lx %ld %ld %c %ln", &number, &h, &nlive, &iterations, &verdict, &n) != 5 || number < 1 || S[n] == '\0')
+	    continue;
+	 if (number > L->size) {
+	    L->proven = (char *) realloc(L->proven, 2 * number * sizeof(char));
+	    L->hash = (unsigned long *) realloc(L->hash, 2 * number * sizeof(unsigned long));
+	    L->text = (char **) realloc(L->text, 2 * number * sizeof(char *));
+	    if (L->proven == NULL || L->hash == NULL || L->text == NULL) {
+	       (void) printf("Not enough memory for the journal\n");
+	       exit(44);
+	    }
+	    for (; L->size < 2 * number; L->size++)
+	       L->proven[L->size] = 0;
+	 }
+	 *strchr(S, '\n') = '\0';
+	 if (L->proven[number - 1])
+	    free(L->text[number - 1]);
+	 L->text[number - 1] = (char *) malloc(strlen(S + n) + 1);
+	 if (L->text[number - 1] == NULL) {
+	    (void) printf("Not enough memory for the journal\n");
+	    exit(44);
+	 }
+	 (void) strcpy(L->text[number - 1], S + n);
+	 L->proven[number - 1] = 1;
+	 L->hash[number - 1] = h;
+      }
+      if (ftell(F) > end && truncate(name, (off_t) end)) {
+	 (void) printf("Can't cut the last line off %s\n", name);
+	 exit(1);
+      }
+      (void) fclose(F);
+   }
+   L->fp = fopen(name, resume ? "a" : "w");
+   if (L->fp == NULL) {
+      (void) printf("Can't open %s\n", name);
+      exit(1);
+   }
+   return (L);
+}
+
+
+long
+Journaled(J, L, text)
+tp_job *J;
+tp_journal *L;
+char *text;
+
+/* Returns 1 if the journal L records that J, whose "ConfText" is text, was
+ * verified by an earlier run, and 0 otherwise. Calls "Fail" if it was, but
+ * J is not the configuration that was verified then, that is, the input
+ * has changed. */
+{
+   if (J->number >= L->size || !L->proven[J->number])
+      return ((long) 0);
+   if (L->hash[J->number] != J->hash || strcmp(L->text[J->number], text)) {
+      (void) fprintf(J->out, "   *** ERROR: CONFIGURATION %ld DIFFERS FROM THE ONE IN THE JOURNAL ***\n", J->number + 1);
+      Fail(J, (long) 66);
+   }
+   (void) fprintf(J->out, "\n   Configuration %ld was verified by an earlier run.\n\n", J->number + 1);
+   return ((long) 1);
+}
+
+
+void
+JournalAdd(J, L, text)
+tp_job *J;
+tp_journal *L;
+char *text;
+
+/* Records in the journal L that J, whose "ConfText" is text, has been
+ * verified */
+{
+   (void) fprintf(L->fp, "conf %ld %016lx %ld %ld %c %s\n", J->number + 1, J->hash, J->nlive, J->iterations, J->contract[0] ? 'C' : 'D', text);
+   (void) fflush(L->fp);
+}
+
+
+tp_cache *
+OpenCache(name, sample, program)
+char name[], program[];
+long sample;
+
+/* Loads the cache called "name", if there is one, and opens it for
+ * appending. Of the results found in it, "sample" percent are verified
+ * again. A cache consists of lines
+ *	<key> <D or C> <ring-size> <extent> <iterations> <nreal> <nlive> ... : <text>
+ * one for each configuration verified, where key is its "CacheKey", there
+ * is a pair nreal, nlive for each iteration, as printed by "testmatch" and
+ * "updatelive", and text is its "ConfText". Unlike the journal it does not
+ * depend on where a configuration is in the input, so it can serve runs
+ * over edited or different configuration files. A last line that was cut
+ * short when a run was killed is ignored. The keys are made with a hash of
+ * this program, read from /proc/self/exe or else from "program" (its
+ * argv[0]), so that results found by a program built from other code or
+ * other compiled-in tables are not used. */
+{
+   long n, i;
+   unsigned long k;
+   char S[1024 + 32 * MAXITER + CONFTEXT];
+   tp_cache *C;
+   FILE *F;
+
+   C = (tp_cache *) malloc(sizeof(tp_cache));
+   if (C == NULL) {
+      (void) printf("Not enough memory for the cache\n");
+      exit(44);
+   }
+   F = fopen("/proc/self/exe", "rb");
+   if (F == NULL && (F = fopen(program, "rb")) == NULL) {
+      (void) printf("Can't read %s to key the cache\n", program);
+      exit(1);
+   }
+   C->program = HashFile(F);
+   (void) fclose(F);
+   F = fopen(name, "r");
+   for (n = 0; F != NULL && fgets(S, sizeof(S), F) != NULL;)
+      n++;
+   for (C->size = 64; C->size < 2 * n; C->size *= 2);
+   C->key = (unsigned long *) calloc(C->size, sizeof(unsigned long));
+   C->entry = (char **) malloc(C->size * sizeof(char *));
+   if (C->key == NULL || C->entry == NULL) {
+      (void) printf("Not enough memory for the cache\n");
+      exit(44);
+   }
+   if (F != NULL) {
+      rewind(F);
+      while (fgets(S, sizeof(S), F) != NULL) {
+	 if (strchr(S, '\n') == NULL || sscanf(S, "%lx %ln", &k, &n) != 1 || k == 0)
+	    continue;
+	 for (i = k & (C->size - 1); C->key[i]; i = (i + 1) & (C->size - 1));
+	 C->entry[i] = (char *) malloc(strlen(S + n) + 1);
+	 if (C->entry[i] == NULL) {
+	    (void) printf("Not enough memory for the cache\n");
+	    exit(44);
+	 }
+	 (void) strcpy(C->entry[i], S + n);
+	 C->key[i] = k;
+      }
+      (void) fclose(F);
+   }
+   C->fp = fopen(name, "a");
+   if (C->fp == NULL) {
+      (void) printf("Can't open %s\n", name);
+      exit(1);
+   }
+   C->sample = sample;
+   C->seed = HASHINIT ^ (unsigned long) time(NULL);
+   C->hits = C->checked = 0;
+   return (C);
+}
+
+
+unsigned long
+CacheKey(J, C)
+tp_job *J;
+tp_cache *C;
+
+/* Returns the key of J in the cache C. It covers the configuration as
+ * read, including the claimed number of extendable colourings and the
+ * contract, and the program that verified it, and "--worklist", which
+ * leaves out the iterations in between. Different configurations may
+ * share a key; "Cached" tells them apart by their "ConfText". */
+{
+   unsigned long k;
+
+   k = Hash(J->hash, (char *) &C->program, (long) sizeof(C->program));
+   if (worklist)
+      k = Hash(k, "worklist", (long) 8);
+   return (k ? k : 1);
+}
+
+
+char *
+Cached(J, C, text)
+tp_job *J;
+tp_cache *C;
+char *text;
+
+/* Returns the entry of the cache C for J, whose "ConfText" is text, or NULL
+ * if it has none. Only an entry with the same key and text will do. */
+{
+   long i, n;
+   unsigned long k;
+   char *t;
+
+   k = CacheKey(J, C);
+   n = (long) strlen(text);
+   for (i = k & (C->size - 1); C->key[i]; i = (i + 1) & (C->size - 1))
+      if (C->key[i] == k && (t = strstr(C->entry[i], " : ")) != NULL && !strncmp(t + 3, text, (size_t) n) && t[n + 3] == '\n')
+	 return (C->entry[i]);
+   return (NULL);
+}
+
+
+long
+Resample(J, C)
+tp_job *J;
+tp_cache *C;
+
+/* Returns 1 if J, which is in the cache C, is to be verified again, and 0
+ * otherwise. The choice depends on the seed of C, so that a different
+ * sample is taken by each run. */
+{
+   unsigned long h;
+
+   if (!C->sample)
+      return ((long) 0);
+   h = Hash(C->seed, (char *) &J->hash, (long) sizeof(J->hash));
+   return ((long) ((long) ((h >> 8) % 100) < C->sample));
+}
+
+
+long
+Replay(J, entry, power)
+tp_job *J;
+char *entry;
+long power[];
+
+/* Prints the output of "testconf" on J from its entry in the cache, just as
+ * "printstatus", "testmatch", "updatelive" and "checkcontract" would have,
+ * and fills in the verdict of J. Returns 1 if successful, and 0 if the
+ * entry is damaged, in which case nothing is printed. */
+{
+   long ring, extent, iterations, i, n;
+   char verdict, *t;
+
+   if (sscanf(entry, "%c %ld %ld %ld%ln", &verdict, &ring, &extent, &iterations, &n) != 4
+       || ring != J->graph[0][1] || iterations < 1 || iterations > MAXITER)
+      return ((long) 0);
+   for (i = 0, t = entry + n; i < 2 * iterations; i++, t += n)
+      if (sscanf(t, " %ld%ln", &J->trace[i], &n) != 1)
+	 return ((long) 0);
+   J->extent = extent;
+   J->iterations = iterations;
+   J->nlive = J->trace[2 * iterations - 1];
+   if ((verdict == 'C') != (J->nlive != 0))
+      return ((long) 0);
+   printstatus(ring, (power[ring] + 1) / 2, extent, J->graph[0][2], J);
+   for (i = 0; i < iterations; i++) {
+      (void) fprintf(J->out, "               %ld\n", J->trace[2 * i]);
+      (void) fprintf(J->out, "            %9ld", J->trace[2 * i + 1]);
+   }
+   if (!J->nlive)
+      (void) fprintf(J->out, "\n\n\n                  ***  D-reducible  ***\n\n\n");
+   else {
+      (void) fprintf(J->out, "\n\n\n                ***  Not D-reducible  ***\n");
+      (void) fprintf(J->out, "               ***  Contract confirmed  ***\n\n");
+   }
+   (void) fflush(J->out);
+   return ((long) 1);
+}
+
+
+void
+CacheAdd(J, C, entry, text)
+tp_job *J;
+tp_cache *C;
+char *entry, *text;
+
+/* Adds the results of J, whose "ConfText" is text, to the cache C. If
+ * "entry" is not NULL, J was verified again, and "Fail" is called if they
+ * are not the same as those in entry. */
+{
+   char S[1024 + 32 * MAXITER + CONFTEXT];
+
+   if (J->iterations > MAXITER)
+      return;
+   CacheLine(J, S, text);
+   if (entry == NULL) {
+      (void) fprintf(C->fp, "%016lx %s", CacheKey(J, C), S);
+      (void) fflush(C->fp);
+      return;
+   }
+   __atomic_fetch_add(&C->checked, (long) 1, __ATOMIC_RELAXED);
+   if (strcmp(S, entry)) {
+      (void) fprintf(J->out, "   *** ERROR: CONFIGURATION %ld DIFFERS FROM ITS RESULTS IN THE CACHE ***\n", J->number + 1);
+      Fail(J, (long) 67);
+   }
+}
+
+
+void
+CacheLine(J, S, text)
+tp_job *J;
+char *S, *text;
+
+/* Writes the line of the cache for J, whose "ConfText" is text, without
+ * the key, into S */
+{
+   long i;
+
+   S += sprintf(S, "%c %ld %ld %ld", J->contract[0] ? 'C' : 'D', J->graph[0][1], J->extent, J->iterations);
+   for (i = 0; i < 2 * J->iterations; i++)
+      S += sprintf(S, " %ld", J->trace[i]);
+   (void) sprintf(S, " : %s\n", text);
+}
+
+
+void
+Merge(nfiles, files)
+int nfiles;
+char *files[];
+
+/* Combines the "--result" files of the shards of a run. Checks that they
+ * come from the same configuration file, that there is exactly one of each
+ * shard, that each is complete, and that every configuration was verified
+ * by the shard it belongs to; then prints the same conclusion as a run
+ * over the whole file. */
+{
+   long i, k, m, n, nshards, nconfs, total, verified, count, number, status;
+   unsigned long hash, h;
+   char S[256], *seen;
+   FILE *F;
+
+   nshards = nconfs = 0;
+   seen = NULL;
+   hash = 0;
+   if (nfiles < 1)
+      MergeErr("No result files given", "", (long) 2);
+   for (i = 0; i < nfiles; i++) {
+      F = fopen(files[i], "r");
+      if (F == NULL)
+	 MergeErr("Can't open", files[i], (long) 1);
+      if (fgets(S, sizeof(S), F) == NULL || sscanf(S, "shard %ld %ld %lx", &k, &n, &h) != 3 || k < 1 || k > n)
+	 MergeErr("Not a result file:", files[i], (long) 60);
+      if (seen == NULL) {
+	 nshards = n;
+	 hash = h;
+	 seen = (char *) calloc(nshards + 1, sizeof(char));
+	 if (seen == NULL)
+	    MergeErr("Not enough memory for the shards of", files[i], (long) 44);
+      } else if (n != nshards || h != hash)
+	 MergeErr("Shard of a different run or configuration file:", files[i], (long) 63);
+      if (seen[k])
+	 MergeErr("Duplicated shard:", files[i], (long) 62);
+      seen[k] = 1;
+
+      /* configurations k, k+n, k+2n, ... followed by the totals */
+      for (number = k, count = 0; fgets(S, sizeof(S), F) != NULL; number += n, count++) {
+	 if (sscanf(S, "total %ld %ld", &total, &verified) == 2)
+	    break;
+	 if (sscanf(S, "%ld %ld", &m, &status) != 2 || m != number)
+	    MergeErr("Configurations missing from", files[i], (long) 64);
+	 if (status) {
+	    (void) printf("Configuration %ld failed with status %ld in %s\n", number, status, files[i]);
+	    exit(65);
+	 }
+      }
+      if (feof(F) || verified != count || count != (total >= k ? (total - k) / n + 1 : 0))
+	 MergeErr("Incomplete shard:", files[i], (long) 64);
+      (void) fclose(F);
+      if (i == 0)
+	 nconfs = total;
+      else if (total != nconfs)
+	 MergeErr("Shard of a different run or configuration file:", files[i], (long) 63);
+   }
+   for (k = 1; k <= nshards; k++)
+      if (!seen[k]) {
+	 (void) printf("Shard %ld of %ld is missing\n", k, nshards);
+	 exit(61);
+      }
+   free(seen);
+   (void) printf("Reducibility of %ld configurations verified\n", nconfs);
+}
+
+
+void
+MergeErr(message, name, status)
+char message[], name[];
+long status;
+{
+   (void) printf("%s %s\n", message, name);
+   exit((int) status);
+}
+
+
+
+long
+testmatch(ring, real, power, live, nchar, J)
+long ring, power[], nchar;
+char *live, *real;
+tp_job *J;
+
+/* This generates all balanced signed matchings, and for each one, tests
+ * whether all associated colourings belong to "live". It writes the answers
+ * in the bits of the characters of "real", and returns the number of them
+ * that are 1. */
+{
+   long a, b, n, interval[2 * MAXINTERVAL + 1], *weight[MAXMATCH + 1], nreal;
+   long matchweight[MAXRING + 1][MAXRING + 1][4], *mw, realterm; // jps
+   char bit;
+
+   nreal = 0;
+   /* "nreal" will be the number of balanced signed matchings such that all
+    * associated colourings belong to "live"; ie the total number of nonzero
+    * bits in the entries of "real" */
+   bit = 1;
+   realterm = 0;
+   /* First, it generates the matchings not incident with the last ring edge */
+
+   for (a = 2; a <= ring; a++)
+      for (b = 1; b < a; b++) {
+	 mw = matchweight[a][b];
+	 mw[0] = 2 * (power[a] + power[b]);
+	 mw[1] = 2 * (power[a] - power[b]);
+	 mw[2] = power[a] + power[b];
+	 mw[3] = power[a] - power[b];
+      }
+   for (a = 2; a < ring; a++)
+      for (b = 1; b < a; b++) {
+	 n = 0;
+	 weight[1] = matchweight[a][b];
+	 if (b >= 3) {
+	    n = 1;
+	    interval[1] = 1;
+	    interval[2] = b - 1;
+	 }
+	 if (a >= b + 3) {
+	    n++;
+	    interval[2 * n - 1] = b + 1;
+	    interval[2 * n] = a - 1;
+	 }
+	 augment(n, interval, (long) 1, weight, matchweight, live, real, &nreal, ring, (long) 0, (long) 0, &bit, &realterm, nchar, (long) 0, J);
+      }
+
+   /* now, the matchings using an edge incident with "ring" */
+   for (a = 2; a <= ring; a++)
+      for (b = 1; b < a; b++) {
+	 mw = matchweight[a][b];
+	 mw[0] = power[a] + power[b];
+	 mw[1] = power[a] - power[b];
+	 mw[2] = -power[a] - power[b];
+	 mw[3] = -power[a] - 2 * power[b];
+      }
+   for (b = 1; b < ring; b++) {
+      n = 0;
+      weight[1] = matchweight[ring][b];
+      if (b >= 3) {
+	 n = 1;
+	 interval[1] = 1;
+	 interval[2] = b - 1;
+      }
+      if (ring >= b + 3) {
+	 n++;
+	 interval[2 * n - 1] = b + 1;
+	 interval[2 * n] = ring - 1;
+      }
+      augment(n, interval, (long) 1, weight, matchweight, live, real, &nreal, ring, (power[ring + 1] - 1) / 2, (long) 1, &bit, &realterm, nchar, (long) 0, J);
+   }
+   (void) fprintf(J->out, "               %ld\n", nreal);
+   (void) fflush(J->out);
+   return (nreal);
+}
+
+
+long
+tablematch(ring, real, power, live, nchar, T, J)
+long ring, power[], nchar;
+char *live, *real;
+tp_table *T;
+tp_job *J;
+
+/* Does the same as "testmatch", taking the matchings from the table T of
+ * "OpenTable" instead of generating them. */
+{
+   long matchweight[2][MAXRING + 1][MAXRING + 1][4], nreal;
+
+   matchweights(ring, power, matchweight);
+   nreal = 0;
+   runtable(T, (long) 0, T->nmatch, (long) 0, matchweight, live, real, &nreal, ring, (power[ring + 1] - 1) / 2, nchar, (long) 0, J);
+   (void) fprintf(J->out, "               %ld\n", nreal);
+   (void) fflush(J->out);
+   return (nreal);
+}
+
+
+void
+runtable(T, first, last, start, matchweight, live, real, pnreal, ring, basecol, nchar, shared, J)
+tp_table *T;
+long first, last, start, matchweight[2][MAXRING + 1][MAXRING + 1][4], *pnreal, ring, basecol, nchar, shared;
+char *live, *real;
+tp_job *J;
+
+/* Runs "checkreality" on the matchings first..last-1 of T, the first of
+ * which has its first signing at bit "start" of "real", as "augment" would
+ * when it reaches them; the matchings with signings that are still real are
+ * kept in J->survivors if that is not NULL. */
+{
+   long i, depth, on, *weight[MAXMATCH + 1], realterm;
+   char bit;
+   tp_matching *M;
+   tp_survivor kept;
+
+   realterm = start >> 3;
+   bit = (char) (1 << (start & 7));
+   for (M = &T->match[first]; M < &T->match[last]; M++) {
+      depth = M->depth;
+      on = M->on;
+      for (i = 1; i <= depth; i++)
+	 weight[i] = matchweight[on][M->match[i][0]][M->match[i][1]];
+      checkreality(depth, weight, live, real, pnreal, ring, on ? basecol : (long) 0, on, &bit, &realterm, &kept, nchar, shared, J);
+      if (J->survivors != NULL && realsigns(kept.mask, (long) MASKS))
+	 keepmatch(J->survivors, &kept, depth, weight, matchweight[on], on, shared);
+   }
+}
+
+
+void
+matchweights(ring, power, matchweight)
+long ring, power[], matchweight[2][MAXRING + 1][MAXRING + 1][4];
+
+/* Fills in the weights of "testmatch" for each match, for the matchings not
+ * incident with "ring" in matchweight[0] and for the others in
+ * matchweight[1] */
+{
+   long a, b;
+
+   for (a = 2; a <= ring; a++)
+      for (b = 1; b < a; b++) {
+	 matchweight[0][a][b][0] = 2 * (power[a] + power[b]);
+	 matchweight[0][a][b][1] = 2 * (power[a] - power[b]);
+	 matchweight[0][a][b][2] = power[a] + power[b];
+	 matchweight[0][a][b][3] = power[a] - power[b];
+	 matchweight[1][a][b][0] = power[a] + power[b];
+	 matchweight[1][a][b][1] = power[a] - power[b];
+	 matchweight[1][a][b][2] = -power[a] - power[b];
+	 matchweight[1][a][b][3] = -power[a] - 2 * power[b];
+      }
+}
+
+
+long
+splitmatch(ring, real, power, live, nchar, T, J)
+long ring, power[], nchar;
+char *live, *real;
+tp_table *T;
+tp_job *J;
+
+/* Does the same as "testmatch", with J->split threads. Each top-level call
+ * of "augment" in "testmatch" is a part of the work, which starts at the
+ * bit of "real" where it would start in "testmatch" (see "matchparts"), so
+ * the result is exactly the same. The threads claim the parts, the largest
+ * first; "stillreal" and "checkreality" then change "live" and "real"
+ * atomically. If T is not NULL the parts are those of the table T. */
+{
+   long i, nthreads, status;
+   tp_split S;
+   pthread_t *thread;
+
+   S.J = J;
+   S.table = T;
+   if (T != NULL) {
+      S.parts = T->parts;
+      S.nparts = T->nparts;
+   } else
+      S.parts = matchparts(ring, &S.nparts);
+   S.next = S.nreal = S.status = 0;
+   S.live = live;
+   S.real = real;
+   S.ring = ring;
+   S.basecol = (power[ring + 1] - 1) / 2;
+   S.nchar = nchar;
+   matchweights(ring, power, S.matchweight);
+   nthreads = J->split < S.nparts ? J->split : S.nparts;
+   thread = (pthread_t *) malloc(nthreads * sizeof(pthread_t));
+   if (thread == NULL) {
+      (void) fprintf(J->out, "Not enough memory for %ld threads\n", nthreads);
+      Fail(J, (long) 44);
+   }
+   for (i = 1; i < nthreads; i++)
+      if (pthread_create(&thread[i], NULL, helper, (void *) &S)) {
+	 (void) printf("Can't start thread %ld\n", i + 1);
+	 exit(45);
+      }
+   (void) helper((void *) &S);
+   for (i = 1; i < nthreads; i++)
+      (void) pthread_join(thread[i], NULL);
+   free(thread);
+   if ((status = S.status) != 0)
+      Fail(J, status);
+   (void) fprintf(J->out, "               %ld\n", S.nreal);
+   (void) fflush(J->out);
+   return (S.nreal);
+}
+
+
+void *
+helper(arg)
+void *arg;
+
+/* The body of each thread of "splitmatch". Calls "Fail" on a job of its own,
+ * which only passes on the output, so that a failure stops the thread that
+ * met it; the others then stop after their current part. */
+{
+   long i, n, interval[2 * MAXINTERVAL + 1], *weight[MAXMATCH + 1], nreal, realterm, status;
+   char bit;
+   tp_split *S;
+   tp_part *P;
+   tp_job *H;
+
+   S = (tp_split *) arg;
+   H = (tp_job *) malloc(sizeof(tp_job));
+   if (H == NULL) {
+      __atomic_store_n(&S->status, (long) 44, __ATOMIC_RELAXED);
+      return (NULL);
+   }
+   H->out = S->J->out;
+   H->survivors = S->J->survivors;
+   H->expand = S->J->expand;
+   nreal = 0;
+   if ((status = setjmp(H->abort)) == 0) {
+      while (!__atomic_load_n(&S->status, __ATOMIC_RELAXED) && (i = __atomic_fetch_add(&S->next, (long) 1, __ATOMIC_RELAXED)) < S->nparts) {
+	 P = &S->parts[i];
+	 if (S->table != NULL) {
+	    runtable(S->table, P->first, P->last, P->start, S->matchweight, S->live, S->real, &nreal, S->ring, S->basecol, S->nchar, (long) 1, H);
+	    continue;
+	 }
+	 realterm = P->start >> 3;
+	 bit = (char) (1 << (P->start & 7));
+	 n = 0;
+	 weight[1] = S->matchweight[P->on][P->a][P->b];
+	 if (P->b >= 3) {
+	    n = 1;
+	    interval[1] = 1;
+	    interval[2] = P->b - 1;
+	 }
+	 if (P->a >= P->b + 3) {
+	    n++;
+	    interval[2 * n - 1] = P->b + 1;
+	    interval[2 * n] = P->a - 1;
+	 }
+	 augment(n, interval, (long) 1, weight, S->matchweight[P->on], S->live, S->real, &nreal, S->ring,
+	    P->on ? S->basecol : (long) 0, P->on, &bit, &realterm, S->nchar, (long) 1, H);
+      }
+   } else
+      __atomic_store_n(&S->status, status, __ATOMIC_RELAXED);
+   (void) __atomic_fetch_add(&S->nreal, nreal, __ATOMIC_RELAXED);
+   free(H);
+   return (NULL);
+}
+
+
+tp_part *
+matchparts(ring, pnparts)
+long ring, *pnparts;
+
+/* Returns the top-level calls of "augment" made by "testmatch" for the
+ * given ring-size, largest first, and their number in *pnparts. They are
+ * counted by "countmatch" the first time, and up to ring-size 16 their
+ * total is checked against simatchnumber. */
+{
+   long a, b, i, j, m, n, start, interval[2 * MAXINTERVAL + 1];
+   tp_part *P, p;
+   static tp_part *parts[MAXRING + 1];
+   static long nparts[MAXRING + 1];
+   static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+   (void) pthread_mutex_lock(&lock);
+   if (parts[ring] == NULL) {
+      P = (tp_part *) malloc(ring * ring * sizeof(tp_part));
+      if (P == NULL) {
+	 (void) printf("Not enough memory to split ring-size %ld\n", ring);
+	 exit(44);
+      }
+      n = 0;
+      for (a = 2; a <= ring; a++)	/* in the order of "testmatch" */
+	 for (b = 1; b < a && a < ring; b++) {
+	    P[n].a = a;
+	    P[n].b = b;
+	    P[n++].on = 0;
+	 }
+      for (b = 1; b < ring; b++) {
+	 P[n].a = ring;
+	 P[n].b = b;
+	 P[n++].on = 1;
+      }
+      for (start = 0, i = 0; i < n; i++) {
+	 m = 0;
+	 if (P[i].b >= 3) {
+	    m = 1;
+	    interval[1] = 1;
+	    interval[2] = P[i].b - 1;
+	 }
+	 if (P[i].a >= P[i].b + 3) {
+	    m++;
+	    interval[2 * m - 1] = P[i].b + 1;
+	    interval[2 * m] = P[i].a - 1;
+	 }
+	 P[i].start = start;
+	 P[i].size = countmatch(m, interval, (long) 1);
+	 start += P[i].size;
+      }
+      if (ring < (long) (sizeof(simatchnumber) / sizeof(long)) && start != simatchnumber[ring]) {
+	 (void) printf("%ld balanced signed matchings of ring-size %ld instead of %ld\n", start, ring, simatchnumber[ring]);
+	 exit(32);
+      }
+      for (i = 1; i < n; i++) {	/* insertion sort by decreasing size */
+	 p = P[i];
+	 for (j = i; j > 0 && P[j - 1].size < p.size; j--)
+	    P[j] = P[j - 1];
+	 P[j] = p;
+      }
+      parts[ring] = P;
+      nparts[ring] = n;
+   }
+   *pnparts = nparts[ring];
+   (void) pthread_mutex_unlock(&lock);
+   return (parts[ring]);
+}
+
+
+long
+matchnumber(ring)
+long ring;
+
+/* Returns the number of balanced signed matchings of the given ring-size,
+ * as counted by "matchparts" (and so checked against simatchnumber up to
+ * ring-size 16) */
+{
+   long i, n, count;
+   tp_part *P;
+
+   P = matchparts(ring, &n);
+   for (count = 0, i = 0; i < n; i++)
+      count += P[i].size;
+   return (count);
+}
+
+
+long
+countmatch(n, interval, depth)
+long n, interval[2 * MAXINTERVAL + 1], depth;
+
+/* Returns the number of signed matchings that "augment" would examine,
+ * given the same arguments, without examining them */
+{
+   long h, i, j, r, newinterval[2 * MAXINTERVAL + 1], newn, lower, upper, count;
+
+   count = (long) 1 << (depth - 1);	/* as in "checkreality" */
+   depth++;
+   for (r = 1; r <= n; r++) {
+      lower = interval[2 * r - 1];
+      upper = interval[2 * r];
+      for (i = lower + 1; i <= upper; i++)
+	 for (j = lower; j < i; j++) {
+	    for (h = 1; h < 2 * r - 1; h++)
+	       newinterval[h] = interval[h];
+	    newn = r - 1;
+	    if (j > lower + 1) {
+	       newn++;
+	       newinterval[h++] = lower;
+	       newinterval[h++] = j - 1;
+	    }
+	    if (i > j + 1) {
+	       newn++;
+	       newinterval[h++] = j + 1;
+	       newinterval[h++] = i - 1;
+	    }
+	    count += countmatch(newn, newinterval, depth);
+	 }
+   }
+   return (count);
+}
+
+void
+tabulate(n, interval, depth, M, F, pnmatch, pnsigned)
+long n, interval[2 * MAXINTERVAL + 1], depth, *pnmatch, *pnsigned;
+tp_matching *M;
+FILE *F;
+
+/* Writes to F the matchings that "augment" would examine, given the same
+ * arguments, in the same order; M has the matches so far. */
+{
+   long h, i, j, r, newinterval[2 * MAXINTERVAL + 1], newn, lower, upper;
+
+   M->depth = (unsigned char) depth;
+   (void) fwrite((void *) M, sizeof(tp_matching), (size_t) 1, F);
+   (*pnmatch)++;
+   *pnsigned += (long) 1 << (depth - 1);
+   if (++depth > MAXMATCH)	/* no room in M; then the count is wrong */
+      return;
+   for (r = 1; r <= n; r++) {
+      lower = interval[2 * r - 1];
+      upper = interval[2 * r];
+      for (i = lower + 1; i <= upper; i++)
+	 for (j = lower; j < i; j++) {
+	    M->match[depth][0] = (unsigned char) i;
+	    M->match[depth][1] = (unsigned char) j;
+	    for (h = 1; h < 2 * r - 1; h++)
+	       newinterval[h] = interval[h];
+	    newn = r - 1;
+	    if (j > lower + 1) {
+	       newn++;
+	       newinterval[h++] = lower;
+	       newinterval[h++] = j - 1;
+	    }
+	    if (i > j + 1) {
+	       newn++;
+	       newinterval[h++] = j + 1;
+	       newinterval[h++] = i - 1;
+	    }
+	    tabulate(newn, newinterval, depth, M, F, pnmatch, pnsigned);
+	 }
+   }
+}
+
+
+void
+MakeTables(dir)
+char dir[];
+
+/* Writes the table of the balanced signed matchings of each ring-size r up
+ * to TABLERING to the file dir/ring<r>.tab. It starts with a header of
+ * TABLEHEAD bytes, padded with zeros, holding a line
+ *	matchings <ring-size> <number of matchings> <number of signed ones>
+ * followed by the entries written by "writetable". */
+{
+   long ring, nmatch, nsigned;
+   char *name, head[TABLEHEAD];
+   FILE *F;
+
+   name = (char *) malloc(strlen(dir) + 16);
+   if (name == NULL) {
+      (void) printf("Not enough memory for the tables\n");
+      exit(44);
+   }
+   for (ring = 2; ring <= TABLERING; ring++) {
+      (void) sprintf(name, "%s/ring%ld.tab", dir, ring);
+      F = fopen(name, "wb");
+      if (F == NULL) {
+	 (void) printf("Can't open %s\n", name);
+	 exit(1);
+      }
+      (void) memset(head, 0, sizeof(head));
+      (void) fwrite((void *) head, sizeof(head), (size_t) 1, F);
+      nmatch = writetable(ring, F, &nsigned);
+      (void) sprintf(head, "matchings %ld %ld %ld\n", ring, nmatch, nsigned);
+      if (fseek(F, 0L, SEEK_SET) || fwrite((void *) head, sizeof(head), (size_t) 1, F) != 1 || fclose(F)) {
+	 (void) printf("Can't write %s\n", name);
+	 exit(1);
+      }
+      (void) printf("Table of %ld matchings of ring-size %ld written to %s\n", nmatch, ring, name);
+      (void) fflush(stdout);
+   }
+   free(name);
+}
+
+
+long
+writetable(ring, F, pnsigned)
+long ring, *pnsigned;
+FILE *F;
+
+/* Writes to F a "tp_matching" for each matching of the given ring-size, in
+ * the order in which "testmatch" generates them; so the signings of each
+ * one have the bits of "real" after those of the one before. Returns the
+ * number of matchings, and that of signed ones in *pnsigned. */
+{
+   long a, b, n, nmatch, interval[2 * MAXINTERVAL + 1];
+   tp_matching M;
+
+   (void) memset((void *) &M, 0, sizeof(M));
+   nmatch = *pnsigned = 0;
+   for (a = 2; a <= ring; a++)	/* as in "testmatch" */
+      for (b = 1; b < a && a < ring; b++) {
+	 n = 0;
+	 if (b >= 3) {
+	    n = 1;
+	    interval[1] = 1;
+	    interval[2] = b - 1;
+	 }
+	 if (a >= b + 3) {
+	    n++;
+	    interval[2 * n - 1] = b + 1;
+	    interval[2 * n] = a - 1;
+	 }
+	 M.match[1][0] = (unsigned char) a;
+	 M.match[1][1] = (unsigned char) b;
+	 tabulate(n, interval, (long) 1, &M, F, &nmatch, pnsigned);
+      }
+   M.on = 1;
+   for (b = 1; b < ring; b++) {
+      n = 0;
+      if (b >= 3) {
+	 n = 1;
+	 interval[1] = 1;
+	 interval[2] = b - 1;
+      }
+      if (ring >= b + 3) {
+	 n++;
+	 interval[2 * n - 1] = b + 1;
+	 interval[2 * n] = ring - 1;
+      }
+      M.match[1][0] = (unsigned char) ring;
+      M.match[1][1] = (unsigned char) b;
+      tabulate(n, interval, (long) 1, &M, F, &nmatch, pnsigned);
+   }
+   if (*pnsigned != matchnumber(ring)) {
+      (void) printf("%ld balanced signed matchings of ring-size %ld instead of %ld\n", *pnsigned, ring, matchnumber(ring));
+      exit(32);
+   }
+   return (nmatch);
+}
+
+tp_table *
+OpenTable(ring)
+long ring;
+
+/* Returns the table of the given ring-size written by "MakeTables" to the
+ * directory of "--tables", or NULL if there is no such directory or the
+ * ring-size is more than TABLERING. The first time, the file is mapped
+ * into memory, so that the processes reading it share it, and checked; it
+ * is then cut into runs of matchings with about the same number of signed
+ * matchings, the parts of "splitmatch". */
+{
+   long r, nmatch, nsigned, i, start, size, fd;
+   char *name, head[TABLEHEAD], *map;
+   struct stat st;
+   tp_matching *M;
+   tp_table *T;
+   tp_part *P;
+   static tp_table *tables[MAXRING + 1];
+   static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+   if (tabledir == NULL || ring > TABLERING)
+      return ((tp_table *) NULL);
+   (void) pthread_mutex_lock(&lock);
+   if (tables[ring] == NULL) {
+      name = (char *) malloc(strlen(tabledir) + 16);
+      T = (tp_table *) malloc(sizeof(tp_table));
+      P = (tp_part *) malloc(TABLEPARTS * sizeof(tp_part));
+      if (name == NULL || T == NULL || P == NULL) {
+	 (void) printf("Not enough memory for the tables\n");
+	 exit(44);
+      }
+      (void) sprintf(name, "%s/ring%ld.tab", tabledir, ring);
+      if ((fd = open(name, O_RDONLY)) < 0 || fstat((int) fd, &st)) {
+	 (void) printf("Can't open %s\n", name);
+	 exit(1);
+      }
+      map = NULL;
+      if (st.st_size >= TABLEHEAD) {
+	 map = (char *) mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, (int) fd, (off_t) 0);
+	 if (map == (char *) MAP_FAILED) {
+	    (void) printf("Can't map %s\n", name);
+	    exit(1);
+	 }
+      }
+      (void) close((int) fd);
+      if (map != NULL) {
+	 (void) memcpy((void *) head, (void *) map, sizeof(head));
+	 head[TABLEHEAD - 1] = '\0';
+      }
+      if (map == NULL || sscanf(head, "matchings %ld %ld %ld", &r, &nmatch, &nsigned) != 3 || r != ring
+	  || nsigned != matchnumber(ring) || st.st_size != TABLEHEAD + nmatch * (long) sizeof(tp_matching))
+	 nmatch = -1;
+      T->match = (tp_matching *) (map + TABLEHEAD);
+      T->nmatch = nmatch;
+      T->parts = P;
+      T->nparts = 0;
+      size = (nsigned + TABLEPARTS - 1) / TABLEPARTS;
+      for (start = 0, i = 0; i < nmatch; i++) {
+	 M = &T->match[i];
+	 for (r = 1; r <= M->depth && M->depth <= ring / 2; r++)
+	    if (M->match[r][1] < 1 || M->match[r][1] >= M->match[r][0] || M->match[r][0] > ring)
+	       break;
+	 if (M->depth < 1 || r <= M->depth || M->on > 1 || (M->on && M->match[1][0] != ring))
+	    break;
+	 if (T->nparts == 0 || P[T->nparts - 1].size >= size) {
+	    P[T->nparts].a = P[T->nparts].b = P[T->nparts].on = 0;
+	    P[T->nparts].start = start;
+	    P[T->nparts].size = 0;
+	    P[T->nparts++].first = i;
+	 }
+	 P[T->nparts - 1].size += (long) 1 << (M->depth - 1);
+	 P[T->nparts - 1].last = i + 1;
+	 start += (long) 1 << (M->depth - 1);
+      }
+      if (i != nmatch || start != matchnumber(ring)) {
+	 (void) printf("%s is not a table of the matchings of ring-size %ld\n", name, ring);
+	 exit(32);
+      }
+      free(name);
+      tables[ring] = T;
+   }
+   (void) pthread_mutex_unlock(&lock);
+   return (tables[ring]);
+}
+
+
+tp_expand *
+OpenExpand(ring, power)
+long ring, power[];
+
+/* Returns the colourings of each balanced signed matching of the given
+ * ring-size, as "stillreal" forms them, or NULL if there is no "--expand"
+ * or the ring-size is more than EXPANDRING. They are found the first time,
+ * going through the matchings of "OpenTable" (or of "writetable" if there
+ * are no tables) and their signings in the order of the bits of "real". */
+{
+   long i, k, m, n, g, depth, on, basecol, nmatch, nsigned, ncodes, pos, v;
+   long *weight[MAXMATCH + 1], sum[MAXSIGN], matchweight[2][MAXRING + 1][MAXRING + 1][4];
+   char *buf;
+   size_t size;
+   tp_matching *M, *match;
+   tp_table *T;
+   tp_expand *E;
+   FILE *F;
+   static tp_expand *expands[MAXRING + 1];
+   static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+   if (!expanding || ring > EXPANDRING)
+      return ((tp_expand *) NULL);
+   (void) pthread_mutex_lock(&lock);
+   if (expands[ring] == NULL) {
+      buf = NULL;
+      if ((T = OpenTable(ring)) != NULL) {
+	 match = T->match;
+	 nmatch = T->nmatch;
+      } else {
+	 if ((F = open_memstream(&buf, &size)) == NULL) {
+	    (void) printf("Not enough memory for the matchings of ring-size %ld\n", ring);
+	    exit(44);
+	 }
+	 nmatch = writetable(ring, F, &nsigned);
+	 if (fclose(F)) {
+	    (void) printf("Not enough memory for the matchings of ring-size %ld\n", ring);
+	    exit(44);
+	 }
+	 match = (tp_matching *) buf;
+      }
+      for (ncodes = 0, M = match; M < match + nmatch; M++)
+	 ncodes += (long) 1 << (2 * M->depth - 2);
+      E = (tp_expand *) malloc(sizeof(tp_expand));
+      if (E != NULL) {
+	 E->at = (unsigned int *) malloc((matchnumber(ring) + 1) * sizeof(unsigned int));
+	 E->code = (unsigned char *) malloc(3 * ncodes * sizeof(unsigned char));
+      }
+      if (E == NULL || E->at == NULL || E->code == NULL) {
+	 (void) printf("Not enough memory to expand ring-size %ld\n", ring);
+	 exit(44);
+      }
+      matchweights(ring, power, matchweight);
+      basecol = (power[ring + 1] - 1) / 2;
+      for (m = 0, pos = 0, M = match; M < match + nmatch; M++) {
+	 depth = M->depth;
+	 on = M->on;
+	 for (i = 1; i <= depth; i++)
+	    weight[i] = matchweight[on][M->match[i][0]][M->match[i][1]];
+	 for (g = 0; g < (long) 1 << (depth - 1); g++) {
+	    n = colourings(weight, depth, g, ring, on ? basecol : (long) 0, sum);
+	    E->at[m++] = (unsigned int) pos;
+	    for (k = 0; k < n; k++, pos++) {
+	       v = sum[k] < 0 ? -2 * sum[k] + 1 : 2 * sum[k];
+	       E->code[3 * pos] = (unsigned char) v;
+	       E->code[3 * pos + 1] = (unsigned char) (v >> 8);
+	       E->code[3 * pos + 2] = (unsigned char) (v >> 16);
+	    }
+	 }
+      }
+      E->at[m] = (unsigned int) pos;
+      free(buf);
+      expands[ring] = E;
+   }
+   (void) pthread_mutex_unlock(&lock);
+   return (expands[ring]);
+}
+
+
+long
+colourings(weight, depth, g, ring, basecol, sum)
+long *weight[MAXMATCH + 1], depth, g, ring, basecol, sum[MAXSIGN];
+
+/* Puts into "sum" the colourings of signing g of a matching, given as to
+ * "checkreality", in the order in which "stillreal" forms them (a negative
+ * entry stands for a twisted colouring), and returns their number */
+{
+   long i, j, b, col, parity, twopower, choice[MAXMATCH + 1];
+
+   col = basecol;	/* as in "survivematch" */
+   parity = ring & 1;
+   for (i = 1; i < depth; i++) {
+      b = (g >> (i - 1)) & 1;
+      parity ^= b;
+      choice[i] = weight[i][b];
+      col += weight[i][2 + b];
+   }
+   choice[depth] = weight[depth][parity];
+   col += weight[depth][2 + parity];
+   sum[0] = col;
+   for (i = 2, twopower = 1; i <= depth; i++, twopower <<= 1)
+      for (j = 0; j < twopower; j++)
+	 sum[twopower + j] = sum[j] - choice[i];
+   return (twopower);
+}
+
+void
+augment(n, interval, depth, weight, matchweight, live, real, pnreal, ring, basecol, on, pbit, prealterm, nchar, shared, J)
+long n, interval[2 * MAXINTERVAL + 1], depth, *weight[MAXMATCH + 1], matchweight[MAXRING + 1][MAXRING + 1][4], *pnreal, ring,
+basecol, on, *prealterm, nchar, shared;
+char *live, *real, *pbit;
+tp_job *J;
+
+/* Finds all matchings such that every match is from one of the given
+ * intervals. (The intervals should be disjoint, and ordered with smallest
+ * first, and lower end given first.) For each such matching it examines all
+ * signings of it, and adjusts the corresponding entries in "real" and
+ * "live". "shared" is nonzero if other threads are adjusting them too. The
+ * matchings with signings that are still real are kept in J->survivors if
+ * that is not NULL. */
+{
+   long h, i, j, r, newinterval[2 * MAXINTERVAL + 1], newn, lower, upper;
+   tp_survivor kept;
+
+   checkreality(depth, weight, live, real, pnreal, ring, basecol, on, pbit, prealterm, &kept, nchar, shared, J);
+   if (J->survivors != NULL && realsigns(kept.mask, (long) MASKS))
+      keepmatch(J->survivors, &kept, depth, weight, matchweight, on, shared);
+   depth++;
+   for (r = 1; r <= n; r++) {
+      lower = interval[2 * r - 1];
+      upper = interval[2 * r];
+      for (i = lower + 1; i <= upper; i++)
+	 for (j = lower; j < i; j++) {
+	    weight[depth] = matchweight[i][j];
+	    for (h = 1; h < 2 * r - 1; h++)
+	       newinterval[h] = interval[h];
+	    newn = r - 1;
+	    if (j > lower + 1) {
+	       newn++;
+	       newinterval[h++] = lower;
+	       newinterval[h++] = j - 1;
+	    }
+	    if (i > j + 1) {
+	       newn++;
+	       newinterval[h++] = j + 1;
+	       newinterval[h++] = i - 1;
+	    }
+	    augment(newn, newinterval, depth, weight, matchweight, live,
+		    real, pnreal, ring, basecol, on, pbit, prealterm, nchar, shared, J);
+	 }
+   }
+}
+
+
+void
+checkreality(depth, weight, live, real, pnreal, ring, basecol, on, pbit, prealterm, kept, nchar, shared, J)
+long depth, *weight[MAXMATCH + 1], *pnreal, ring, basecol, on, *prealterm, nchar, shared;
+char *live, *real, *pbit;
+tp_survivor *kept;
+tp_job *J;
+
+/* For a given matching M, it runs through all signings, and checks which of
+ * them have the property that all associated colourings belong to "live". It
+ * writes the answers into bits of "real", starting at the point specified by
+ * "bit" and "realterm". "basecol" is for convenience in computing the
+ * associated colourings; it is zero for matchings not incident with "ring".
+ * "on" is nonzero iff the matching is incident with "ring". The signings
+ * that are still real are put in kept->mask, and their first bit in
+ * kept->start. */
+{
+   long i, k, g, b, first, term, nbits, choice[MAXMATCH + 1], col, parity;
+   char mask;
+
+   nbits = 1 << (depth - 1);
+   if (!*pbit) {
+      *pbit = 1;
+      ++(*prealterm);
+   }
+   for (first = 0; !(*pbit & 1 << first); first++);
+   /* signing k=a_1+2a_2+4a_3+... (a_i=1 if match i+1 has sign 1) has the
+    * bit first+k after bit 0 of real[*prealterm] */
+   if (*prealterm + (first + nbits - 1) / 8 > nchar) {
+      (void) fprintf(J->out, "More than %ld entries in real are needed\n", nchar + 1);
+      Fail(J, (long) 32);
+   }
+   kept->start = 8 * *prealterm + first;
+   (void) memset((void *) kept->mask, 0, sizeof(kept->mask));
+   col = basecol;
+   parity = ring & 1;
+   for (i = 1; i < depth; i++) {
+      choice[i] = weight[i][0];
+      col += weight[i][2];
+   }
+   choice[depth] = weight[depth][parity];
+   col += weight[depth][2 + parity];
+   /* g runs through all subsets of M minus the first match in Gray-code
+    * order, so that one match and the last one change sign each time */
+   for (k = 0, g = 0;;) {
+      b = first + g;
+      term = *prealterm + (b >> 3);
+      mask = (char) (1 << (b & 7));
+      if (real[term] & mask) {
+	 if (J->expand != NULL ? !stilltable(J->expand, 8 * *prealterm + b, live, on, shared)
+	     : !stillreal(col, choice, depth, live, on, shared)) {
+	    if (shared)	/* other threads may own the other bits */
+	       (void) __atomic_fetch_xor(&real[term], mask, __ATOMIC_RELAXED);
+	    else
+	       real[term] ^= mask;
+	 } else {
+	    (*pnreal)++;
+	    kept->mask[g >> 6] |= 1UL << (g & 63);
+	 }
+      }
+      if (++k == nbits)
+	 break;
+      i = __builtin_ctzl((unsigned long) k) + 1;	/* the match to change */
+      g ^= k & -k;
+      if (g & k & -k) {
+	 choice[i] = weight[i][1];
+	 col += weight[i][3] - weight[i][2];
+      } else {
+	 choice[i] = weight[i][0];
+	 col += weight[i][2] - weight[i][3];
+      }
+      col -= weight[depth][2 + parity];
+      parity ^= 1;
+      choice[depth] = weight[depth][parity];
+      col += weight[depth][2 + parity];
+   }
+   b = first + nbits - 1;
+   *prealterm += b >> 3;
+   *pbit = (char) (1 << (b & 7) << 1);
+}
+
+
+void
+keepmatch(K, kept, depth, weight, matchweight, on, shared)
+tp_survivors *K;
+tp_survivor *kept;
+long depth, *weight[MAXMATCH + 1], matchweight[MAXRING + 1][MAXRING + 1][4], on, shared;
+
+/* Adds to K the matching of "augment" with the signings in kept, unless K
+ * is full or there is no memory for it; then K->full is set. The matches
+ * are found from where their weights are in matchweight. */
+{
+   long i, h, n;
+   tp_survivor *R;
+
+   if (shared)
+      n = __atomic_fetch_add(&K->n, (long) 1, __ATOMIC_RELAXED);
+   else
+      n = K->n++;
+   if (n >= K->max || (R = survivor(K, n, (long) 1)) == NULL) {
+      __atomic_store_n(&K->full, (long) 1, __ATOMIC_RELAXED);
+      return;
+   }
+   R->start = kept->start;
+   (void) memcpy((void *) R->mask, (void *) kept->mask, K->words * sizeof(unsigned long));
+   R->depth = (char) depth;
+   R->on = (char) on;
+   for (i = 1; i <= depth; i++) {
+      h = (weight[i] - matchweight[0][0]) / 4;
+      R->match[i][0] = (unsigned char) (h / (MAXRING + 1));
+      R->match[i][1] = (unsigned char) (h % (MAXRING + 1));
+   }
+}
+
+
+tp_survivor *
+survivor(K, n, make)
+tp_survivors *K;
+long n, make;
+
+/* Returns entry n of K. Chunk c of K holds SURVIVORBASE << c entries, so
+ * that K only takes as much memory as the matchings that are kept. If the
+ * chunk of entry n has not been allocated yet, it is if "make" is nonzero,
+ * atomically as other threads may be adding to K too; otherwise, or if
+ * there is not enough memory, NULL is returned. */
+{
+   long c, q;
+   char *chunk, *none;
+
+   q = n / SURVIVORBASE + 1;
+   c = 63 - __builtin_clzl((unsigned long) q);	/* the chunk, starting */
+   if (c >= SURVIVORCHUNKS)	/* at entry SURVIVORBASE * (2^c - 1) */
+      return ((tp_survivor *) NULL);
+   chunk = __atomic_load_n(&K->chunk[c], __ATOMIC_ACQUIRE);
+   if (chunk == NULL && make) {
+      chunk = (char *) malloc((SURVIVORBASE << c) * K->stride);
+      none = NULL;
+      if (chunk != NULL && !__atomic_compare_exchange_n(&K->chunk[c], &none, chunk, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+	 free(chunk);	/* another thread has made it */
+	 chunk = none;
+      }
+   }
+   if (chunk == NULL)
+      return ((tp_survivor *) NULL);
+   return ((tp_survivor *) (chunk + (n - SURVIVORBASE * ((1L << c) - 1)) * K->stride));
+}
+
+
+long
+realsigns(mask, words)
+unsigned long mask[];
+long words;
+
+/* Returns the number of signings whose bits are set in the first "words"
+ * words of mask, that of a "tp_survivor" */
+{
+   long k, n;
+
+   for (n = 0, k = 0; k < words; k++)
+      n += __builtin_popcountl(mask[k]);
+   return (n);
+}
+
+
+long
+survivematch(ring, real, power, live, K, J)
+long ring, power[];
+char *live, *real;
+tp_survivors *K;
+tp_job *J;
+
+/* Does the same as "testmatch" when K holds all the matchings with
+ * signings that are still real, looking only at those signings, and drops
+ * the matchings none of whose signings stay real. */
+{
+   long a, b, i, j, k, g, n, nreal, depth, col, parity, choice[MAXMATCH + 1], *weight[MAXMATCH + 1];
+   long matchweight[2][MAXRING + 1][MAXRING + 1][4], basecol;
+   unsigned long m;
+   tp_survivor *R;
+
+   matchweights(ring, power, matchweight);
+   basecol = (power[ring + 1] - 1) / 2;
+   nreal = 0;
+   for (n = 0, j = 0; j < K->n; j++) {
+      R = survivor(K, j, (long) 0);
+      depth = R->depth;
+      for (i = 1; i <= depth; i++)
+	 weight[i] = matchweight[(int) R->on][R->match[i][0]][R->match[i][1]];
+      for (k = 0; k < K->words; k++)
+	 for (m = R->mask[k]; m; m &= m - 1) {
+	    g = 64 * k + __builtin_ctzl(m);	/* the signing, as in "checkreality" */
+	    col = R->on ? basecol : 0;
+	    parity = ring & 1;
+	    for (i = 1; i < depth; i++) {
+	       b = (g >> (i - 1)) & 1;
+	       parity ^= b;
+	       choice[i] = weight[i][b];
+	       col += weight[i][2 + b];
+	    }
+	    choice[depth] = weight[depth][parity];
+	    col += weight[depth][2 + parity];
+	    a = R->start + g;
+	    if (J->expand != NULL ? stilltable(J->expand, a, live, (long) R->on, (long) 0)
+		: stillreal(col, choice, depth, live, (long) R->on, (long) 0))
+	       nreal++;
+	    else {
+	       real[a >> 3] ^= (char) (1 << (a & 7));
+	       R->mask[k] ^= 1UL << (g & 63);
+	    }
+	 }
+      if (realsigns(R->mask, K->words) && n++ < j)
+	 (void) memcpy((void *) survivor(K, n - 1, (long) 0), (void *) R, (size_t) K->stride);
+   }
+   K->n = n;
+   (void) fprintf(J->out, "               %ld\n", nreal);
+   (void) fflush(J->out);
+   return (nreal);
+}
+
+
+tp_survivors *
+keeping(W, ring)
+tp_work *W;
+long ring;
+
+/* Returns the space in W for the matchings kept by "augment" for the given
+ * ring-size. Each entry only has room for the signings of a matching of the
+ * ring-size, and there is room for as many as fit in SURVIVORS bytes;
+ * beyond that a pass of "testmatch" may not leave few enough. It grows as
+ * they are kept, see "survivor". */
+{
+   long i, words;
+
+   words = ((1L << (ring / 2 - 1)) + 63) / 64;
+   if (W->kept.words != words) {	/* the entries are not the same size */
+      for (i = 0; i < SURVIVORCHUNKS; i++) {
+	 free(W->kept.chunk[i]);
+	 W->kept.chunk[i] = NULL;
+      }
+      W->kept.words = words;
+      W->kept.stride = (long) (offsetof(tp_survivor, mask) + words * sizeof(unsigned long));
+   }
+   W->kept.max = SURVIVORS / W->kept.stride;
+   if (W->kept.max > matchnumber(ring))
+      W->kept.max = matchnumber(ring);
+   return (&W->kept);
+}
+
+
+long
+stillreal(col, choice, depth, live, on, shared)
+long col, choice[MAXMATCH + 1], depth, on, shared;
+char *live;
+
+/* Given a signed matching, this checks if all associated colourings are in
+ * "live", and, if so, records that fact on the bits of the corresponding
+ * entries of "live". If "shared" is nonzero other threads are doing the
+ * same, so the bits are set atomically. */
+{
+   long sum[MAXSIGN], mark, i, j, twopower, b, c;
+   long twisted[MAXSIGN], ntwisted, untwisted[MAXSIGN], nuntwisted;
+
+#ifdef X86SIMD
+   if (depth >= GATHERDEPTH) {
+      if (__builtin_cpu_supports("avx512f"))
+	 return (stillgather512(col, choice, depth, live, on, shared));
+      if (__builtin_cpu_supports("avx2"))
+	 return (stillgather(col, choice, depth, live, on, shared));
+   }
+#endif
+   ntwisted = nuntwisted = 0;
+   if (col < 0) {
+      if (!LIVE(live, -col))
+	 return ((long) 0);
+      twisted[ntwisted++] = -col;
+      sum[0] = col;
+   } else {
+      if (!LIVE(live, col))
+	 return ((long) 0);
+      untwisted[nuntwisted++] = sum[0] = col;
+   }
+   for (i = 2, twopower = 1, mark = 1; i <= depth; i++, twopower <<= 1) {
+      c = choice[i];
+      for (j = 0; j < twopower; j++, mark++) {
+	 b = sum[j] - c;
+	 if (b < 0) {
+	    if (!LIVE(live, -b))
+	       return ((long) 0);
+	    twisted[ntwisted++] = -b;
+	    sum[mark] = b;
+	 } else {
+	    if (!LIVE(live, b))
+	       return ((long) 0);
+	    untwisted[nuntwisted++] = sum[mark] = b;
+	 }
+      }
+   }
+
+   /* Now we know that every coloring that theta-fits M has its code in
+    * "live". We mark the corresponding entry of "live" by theta, that is,
+    * set its second, third or fourth bit to 1 */
+
+   if (shared) {
+      c = on ? 8 : 2;
+      for (i = 0; i < ntwisted; i++) {
+	 b = twisted[i];
+	 if ((LIVE(live, b) & c) != c)
+	    (void) __atomic_fetch_or(&live[b >> 1], LIVEBITS(b, c), __ATOMIC_RELAXED);
+      }
+      c = on ? 4 : 2;
+      for (i = 0; i < nuntwisted; i++) {
+	 b = untwisted[i];
+	 if ((LIVE(live, b) & c) != c)
+	    (void) __atomic_fetch_or(&live[b >> 1], LIVEBITS(b, c), __ATOMIC_RELAXED);
+      }
+   } else if (on) {
+      for (i = 0; i < ntwisted; i++)
+	 live[twisted[i] >> 1] |= LIVEBITS(twisted[i], 8);
+      for (i = 0; i < nuntwisted; i++)
+	 live[untwisted[i] >> 1] |= LIVEBITS(untwisted[i], 4);
+   } else {
+      for (i = 0; i < ntwisted; i++)
+	 live[twisted[i] >> 1] |= LIVEBITS(twisted[i], 2);
+      for (i = 0; i < nuntwisted; i++)
+	 live[untwisted[i] >> 1] |= LIVEBITS(untwisted[i], 2);
+   }
+
+   return ((long) 1);
+}
+
+
+long
+stilltable(E, m, live, on, shared)
+tp_expand *E;
+long m, on, shared;
+char *live;
+
+/* Same as "stillreal" for signed matching m (the bit of "real" that it
+ * has), with the colourings looked up in E */
+{
+   long b, c, v;
+   unsigned char *p, *first, *last;
+
+   first = E->code + 3 * (long) E->at[m];
+   last = E->code + 3 * (long) E->at[m + 1];
+   for (p = first; p < last; p += 3) {
+      b = (p[0] | p[1] << 8 | (long) p[2] << 16) >> 1;
+      if (!LIVE(live, b))
+	 return ((long) 0);
+   }
+   for (p = first; p < last; p += 3) {
+      v = p[0] | p[1] << 8 | (long) p[2] << 16;
+      b = v >> 1;
+      if (v & 1)
+	 c = on ? 8 : 2;
+      else
+	 c = on ? 4 : 2;
+      if (!shared)
+	 live[b >> 1] |= LIVEBITS(b, c);
+      else if ((LIVE(live, b) & c) != c)
+	 (void) __atomic_fetch_or(&live[b >> 1], LIVEBITS(b, c), __ATOMIC_RELAXED);
+   }
+   return ((long) 1);
+}
+
+
+long
+updatelive(live, ncols, p, L, J)
+long *p, ncols;
+char *live;
+tp_livelist *L;
+tp_job *J;
+
+/* runs through "live" to see which colourings still have `real' signed
+ * matchings sitting on all three pairs of colour classes, and updates "live"
+ * accordingly; returns 1 if nlive got smaller and stayed >0, and 0 otherwise.
+ * The two codes held in each character are done together. Once fewer than
+ * 1/SPARSELIVE of the codes are live, they are also listed in L, and then
+ * only they are run through; "live" stays the same, since the others are
+ * 0. The way it was done is logged in J->folds. */
+{
+   long nlive, newnlive, nchar;
+
+   nlive = *p;
+   nchar = (ncols + 1) / 2;
+   if (LIVE(live, 0) > 1)
+      live[0] |= 15;
+   if (J->iterations < MAXITER)
+      J->folds[J->iterations] = L->n >= 0 ? 's' : 'd';
+   if (L->n >= 0)
+      newnlive = foldlist(live, L);
+   else
+#ifdef X86SIMD
+   if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+      newnlive = foldavx2(live, nchar);
+   else if (__builtin_cpu_supports("sse2"))
+      newnlive = foldsse2(live, nchar);
+   else
+#endif
+      newnlive = foldlive(live, (long) 0, nchar);
+   if (L->n < 0 && newnlive * SPARSELIVE < ncols)
+      makelist(live, ncols, newnlive, L);
+   *p = newnlive;
+   (void) fprintf(J->out, "            %9ld", newnlive);
+   (void) fflush(J->out);
+   if ((newnlive < nlive) && (newnlive > 0))
+      return ((long) 1);
+   printverdict(newnlive, J);
+   return ((long) 0);
+}
+
+
+long
+foldlist(live, L)
+char *live;
+tp_livelist *L;
+
+/* Does the work of "foldlive" on the codes in L, the only ones that are
+ * live, and drops those that are not live any more from L. Returns the
+ * number that stay live. */
+{
+   long i, n, c;
+
+   for (n = 0, i = 0; i < L->n; i++) {
+      c = L->code[i];
+      if (LIVE(live, c) == 15) {
+	 live[c >> 1] ^= LIVEBITS(c, 14);
+	 L->code[n++] = (int) c;
+      } else
+	 live[c >> 1] &= ~LIVEBITS(c, 15);
+   }
+   L->n = n;
+   return (n);
+}
+
+
+void
+makelist(live, ncols, nlive, L)
+char *live;
+long ncols, nlive;
+tp_livelist *L;
+
+/* Lists in L the nlive codes that are live, if there is room for them;
+ * otherwise L stays empty and "live" dense. */
+{
+   long c, n;
+
+   if (L->max < nlive) {
+      free(L->code);
+      L->code = (int *) malloc(nlive * sizeof(int));
+      L->max = L->code == NULL ? 0 : nlive;
+   }
+   if (L->code == NULL)
+      return;
+   for (n = 0, c = 0; c < ncols; c++)
+      if (LIVE(live, c))
+	 L->code[n++] = (int) c;
+   L->n = n;
+}
+
+long
+fixlive(ring, real, power, live, ncodes, pnlive, K, J)
+long ring, power[], ncodes, *pnlive;
+char *live, *real;
+tp_survivors *K;
+tp_job *J;
+
+/* Does what the rest of the iterations of "survivematch" and "updatelive"
+ * would do, when K holds the matchings left by the last one, and returns
+ * the number of balanced signed matchings that are still real at the end;
+ * or -1, having done nothing, if there is not enough memory or the ring is
+ * too big for its pairs to fit in an int. For each code
+ * it keeps the signed matchings it is in, and for each of the three ways of
+ * marking it in "stillreal" the number of those that are real. When a
+ * colouring drops out of "live" only its signed matchings are examined
+ * again, and those colourings of theirs that are left unmarked drop out in
+ * turn. It ends with the same "live" as the iterations would. */
+{
+   long a, c, d, e, g, i, j, k, n, p, s, nsigned, npairs, nreal, nlive, top, depth, basecol;
+   long *weight[MAXMATCH + 1], sum[MAXSIGN], matchweight[2][MAXRING + 1][MAXRING + 1][4], *at, *bit, *first;
+   int *code, *inv, *cnt, *stack;
+   char *alive;
+   unsigned long m;
+   tp_survivor *R;
+
+   for (nsigned = npairs = 0, j = 0; j < K->n; j++) {
+      R = survivor(K, j, (long) 0);
+      n = realsigns(R->mask, K->words);
+      nsigned += n;
+      npairs += n << (R->depth - 1);
+   }
+   if (4 * ncodes > INT_MAX || npairs > INT_MAX)
+      return ((long) -1);
+   at = (long *) malloc((nsigned + 1) * sizeof(long));
+   bit = (long *) malloc((nsigned + 1) * sizeof(long));
+   alive = (char *) malloc((nsigned + 1) * sizeof(char));
+   code = (int *) malloc((npairs + 1) * sizeof(int));
+   inv = (int *) malloc((npairs + 1) * sizeof(int));
+   first = (long *) calloc(ncodes + 1, sizeof(long));
+   cnt = (int *) calloc(4 * ncodes, sizeof(int));
+   stack = (int *) malloc(ncodes * sizeof(int));
+   if (at == NULL || bit == NULL || alive == NULL || code == NULL || inv == NULL || first == NULL || cnt == NULL || stack == NULL) {
+      free(at);
+      free(bit);
+      free(alive);
+      free(code);
+      free(inv);
+      free(first);
+      free(cnt);
+      free(stack);
+      return ((long) -1);
+   }
+
+   /* each colouring of a signed matching is a "pair" 4c+t, where c is its
+    * code and t is 0, 1 or 2 if "stillreal" sets bit 2, 4 or 8 for it;
+    * cnt[4c+t] is the number of real signed matchings with that pair, and
+    * first[c]..first[c+1]-1 are the entries of inv with those having c */
+   matchweights(ring, power, matchweight);
+   basecol = (power[ring + 1] - 1) / 2;
+   for (s = 0, p = 0, j = 0; j < K->n; j++) {
+      R = survivor(K, j, (long) 0);
+      depth = R->depth;
+      for (i = 1; i <= depth; i++)
+	 weight[i] = matchweight[(int) R->on][R->match[i][0]][R->match[i][1]];
+      for (k = 0; k < K->words; k++)
+	 for (m = R->mask[k]; m; m &= m - 1) {
+	    g = 64 * k + __builtin_ctzl(m);
+	    n = colourings(weight, depth, g, ring, R->on ? basecol : (long) 0, sum);
+	    at[s] = p;
+	    bit[s] = R->start + g;
+	    alive[s++] = 1;
+	    for (i = 0; i < n; i++) {
+	       c = sum[i] < 0 ? -sum[i] : sum[i];
+	       d = 4 * c + (!R->on ? 0 : sum[i] < 0 ? 2 : 1);
+	       code[p++] = (int) d;
+	       cnt[d]++;
+	       first[c]++;
+	    }
+	 }
+   }
+   at[s] = p;
+   for (c = 1; c < ncodes; c++)
+      first[c] += first[c - 1];
+   first[ncodes] = npairs;
+   for (s = nsigned - 1; s >= 0; s--)
+      for (p = at[s]; p < at[s + 1]; p++)
+	 inv[--first[code[p] >> 2]] = (int) s;
+
+   nlive = *pnlive;
+   nreal = nsigned;
+   for (top = 0, c = 0; c < ncodes; c++)
+      if (!LIVE(live, c)) {
+	 if (first[c + 1] > first[c])
+	    stack[top++] = (int) c;
+      } else if (STARVED(cnt, c)) {
+	 live[c >> 1] &= ~LIVEBITS(c, 15);
+	 nlive--;
+	 stack[top++] = (int) c;
+      }
+   while (top) {
+      c = stack[--top];
+      for (j = first[c]; j < first[c + 1]; j++) {
+	 s = inv[j];
+	 if (!alive[s])
+	    continue;
+	 alive[s] = 0;
+	 nreal--;
+	 a = bit[s];
+	 real[a >> 3] ^= (char) (1 << (a & 7));
+	 for (p = at[s]; p < at[s + 1]; p++) {
+	    d = code[p];
+	    e = d >> 2;
+	    if (--cnt[d] == 0 && LIVE(live, e) && STARVED(cnt, e)) {
+	       live[e >> 1] &= ~LIVEBITS(e, 15);
+	       nlive--;
+	       stack[top++] = (int) e;
+	    }
+	 }
       }
-      augment(n, interval, (long) 1, weight, matchweight, live, real, &nreal, ring, (power[ring + 1] - 1) / 2, (long) 1, &bit, &realterm, nchar);
    }
-   (void) printf("               %ld\n", nreal);
-   (void) fflush(stdout);
+   free(at);
+   free(bit);
+   free(alive);
+   free(code);
+   free(inv);
+   free(first);
+   free(cnt);
+   free(stack);
+   *pnlive = nlive;
+   if (J->iterations < MAXITER)
+      J->folds[J->iterations] = 'w';
+   (void) fprintf(J->out, "               %ld\n", nreal);
+   (void) fprintf(J->out, "            %9ld", nlive);
+   printverdict(nlive, J);
+   return (nreal);
 }
 
+
+
 void
-augment(n, interval, depth, weight, matchweight, live, real, pnreal, ring, basecol, on, pbit, prealterm, nchar)
-long n, interval[10], depth, *weight[8], matchweight[MAXRING + 1][MAXRING + 1][4], *pnreal, ring, // jps
-basecol, on, *prealterm, nchar;
-char *live, *real, *pbit;
+printverdict(nlive, J)
+long nlive;
+tp_job *J;
 
-/* Finds all matchings such that every match is from one of the given
- * intervals. (The intervals should be disjoint, and ordered with smallest
- * first, and lower end given first.) For each such matching it examines all
- * signings of it, and adjusts the corresponding entries in "real" and
- * "live". */
+/* Writes whether the configuration is D-reducible, once "live" is final
+ * with nlive colourings */
 {
-   long h, i, j, r, newinterval[10], newn, lower, upper;
+   if (!nlive)
+      (void) fprintf(J->out, "\n\n\n                  ***  D-reducible  ***\n\n");
+   else
+      (void) fprintf(J->out, "\n\n\n                ***  Not D-reducible  ***\n");
+}
 
-   checkreality(depth, weight, live, real, pnreal, ring, basecol, on, pbit, prealterm, nchar);
-   depth++;
-   for (r = 1; r <= n; r++) {
-      lower = interval[2 * r - 1];
-      upper = interval[2 * r];
-      for (i = lower + 1; i <= upper; i++)
-	 for (j = lower; j < i; j++) {
-	    weight[depth] = matchweight[i][j];
-	    for (h = 1; h < 2 * r - 1; h++)
-	       newinterval[h] = interval[h];
-	    newn = r - 1;
-	    if (j > lower + 1) {
-	       newn++;
-	       newinterval[h++] = lower;
-	       newinterval[h++] = j - 1;
-	    }
-	    if (i > j + 1) {
-	       newn++;
-	       newinterval[h++] = j + 1;
-	       newinterval[h++] = i - 1;
-	    }
-	    augment(newn, newinterval, depth, weight, matchweight, live,
-		    real, pnreal, ring, basecol, on, pbit, prealterm, nchar);
-	 }
+long
+foldlive(live, first, last)
+char *live;
+long first, last;
+
+/* Does the work of "updatelive" on characters first to last-1 of "live":
+ * the half of a character for a code becomes 1 if it was 15 and 0
+ * otherwise. Returns the number of codes that stay live. */
+{
+   long i, lo, hi, n;
+
+   for (n = 0, i = first; i < last; i++) {
+      lo = (live[i] & 15) == 15;
+      hi = (live[i] & 240) == 240;
+      n += lo + hi;
+      live[i] = (char) (lo | hi << 4);
    }
+   return (n);
 }
 
+#ifdef X86SIMD
 
 void
-checkreality(depth, weight, live, real, pnreal, ring, basecol, on, pbit, prealterm, nchar)
-long depth, *weight[8], *pnreal, ring, basecol, on, *prealterm, nchar;
-char *live, *real, *pbit;
+marklive(sum, n, live, on, shared)
+int sum[];
+long n, on, shared;
+char *live;
 
-/* For a given matching M, it runs through all signings, and checks which of
- * them have the property that all associated colourings belong to "live". It
- * writes the answers into bits of "real", starting at the point specified by
- * "bit" and "realterm". "basecol" is for convenience in computing the
- * associated colourings; it is zero for matchings not incident with "ring".
- * "on" is nonzero iff the matching is incident with "ring". */
+/* Marks the codes of the n colourings in "sum" as "stillreal" does, where
+ * a negative entry stands for a twisted colouring */
 {
-   long i, k, nbits, choice[8], col, parity;
-   unsigned long left;
+   long i, b, c;
 
-   nbits = 1 << (depth - 1);
-   /* k will run through all subsets of M minus the first match */
-   for (k = 0; k < nbits; k++, *pbit <<= 1) {
-      if (!*pbit) {
-	 *pbit = 1;
-	 ++(*prealterm);
-	 if (*prealterm > nchar) {
-	    (void) printf("More than %ld entries in real are needed\n", nchar + 1);
-	    exit(32);
-	 }
-      }
-      if (!(*pbit & real[*prealterm]))
-	 continue;
-      col = basecol;
-      parity = ring & 1;
-      for (i = 1, left = k; i < depth; i++, left >>= 1) {
-	 if (left & 1) {	/* i.e. if a_i=1, where k=a_1+2a_2+4a_3+... */
-	    parity ^= 1;
-	    choice[i] = weight[i][1];
-	    col += weight[i][3];
-	 } else {
-	    choice[i] = weight[i][0];
-	    col += weight[i][2];
-	 }
-      }
-      if (parity) {
-	 choice[depth] = weight[depth][1];
-	 col += weight[depth][3];
+   for (i = 0; i < n; i++) {
+      if (sum[i] < 0) {
+	 b = -sum[i];
+	 c = on ? 8 : 2;
       } else {
-	 choice[depth] = weight[depth][0];
-	 col += weight[depth][2];
+	 b = sum[i];
+	 c = on ? 4 : 2;
       }
-      if (!stillreal(col, choice, depth, live, on)) {
-	 real[*prealterm] ^= *pbit;
-      } else
-	 (*pnreal)++;
+      if (!shared)
+	 live[b >> 1] |= LIVEBITS(b, c);
+      else if ((LIVE(live, b) & c) != c)
+	 (void) __atomic_fetch_or(&live[b >> 1], LIVEBITS(b, c), __ATOMIC_RELAXED);
    }
 }
 
-
-long
-stillreal(col, choice, depth, live, on)
-long col, choice[8], depth, on;
+__attribute__((target("avx2"))) long
+stillgather(col, choice, depth, live, on, shared)
+long col, choice[MAXMATCH + 1], depth, on, shared;
 char *live;
 
-/* Given a signed matching, this checks if all associated colourings are in
- * "live", and, if so, records that fact on the bits of the corresponding
- * entries of "live". */
+/* Same as "stillreal", for depth at least 4. The sums are formed 8 at a
+ * time, in the same order, and their codes looked up in "live" with
+ * gathers; "live" must have 3 characters to spare after the last code. */
 {
-   long sum[128], mark, i, j, twopower, b, c; // jps
-   long twisted[128], ntwisted, untwisted[128], nuntwisted; // jps
+   int sum[MAXSIGN] __attribute__((aligned(32)));
+   long i, j, twopower;
+   __m256i v, one, fifteen;
 
-   ntwisted = nuntwisted = 0;
-   if (col < 0) {
-      if (!live[-col])
-	 return ((long) 0);
-      twisted[ntwisted++] = -col;
-      sum[0] = col;
-   } else {
-      if (!live[col])
-	 return ((long) 0);
-      untwisted[nuntwisted++] = sum[0] = col;
-   }
-   for (i = 2, twopower = 1, mark = 1; i <= depth; i++, twopower <<= 1) {
-      c = choice[i];
-      for (j = 0; j < twopower; j++, mark++) {
-	 b = sum[j] - c;
-	 if (b < 0) {
-	    if (!live[-b])
-	       return ((long) 0);
-	    twisted[ntwisted++] = -b;
-	    sum[mark] = b;
-	 } else {
-	    if (!live[b])
-	       return ((long) 0);
-	    untwisted[nuntwisted++] = sum[mark] = b;
-	 }
+   sum[0] = (int) col;
+   for (i = 2, twopower = 1; i <= depth; i++, twopower <<= 1) {
+      if (twopower < 8)
+	 for (j = 0; j < twopower; j++)
+	    sum[twopower + j] = sum[j] - (int) choice[i];
+      else {
+	 v = _mm256_set1_epi32((int) choice[i]);
+	 for (j = 0; j < twopower; j += 8)
+	    _mm256_store_si256((__m256i *) (sum + twopower + j), _mm256_sub_epi32(_mm256_load_si256((__m256i *) (sum + j)), v));
       }
    }
+   one = _mm256_set1_epi32(1);
+   fifteen = _mm256_set1_epi32(15);
+   for (j = 0; j < twopower; j += 8) {
+      v = _mm256_abs_epi32(_mm256_load_si256((__m256i *) (sum + j)));
+      /* the 4 bits of code v are those of character v/2 shifted by 4(v&1) */
+      v = _mm256_srlv_epi32(_mm256_i32gather_epi32((const int *) live, _mm256_srli_epi32(v, 1), 1),
+	 _mm256_slli_epi32(_mm256_and_si256(v, one), 2));
+      v = _mm256_cmpeq_epi32(_mm256_and_si256(v, fifteen), _mm256_setzero_si256());
+      if (_mm256_movemask_epi8(v))
+	 return ((long) 0);
+   }
+   marklive(sum, twopower, live, on, shared);
+   return ((long) 1);
+}
 
-   /* Now we know that every coloring that theta-fits M has its code in
-    * "live". We mark the corresponding entry of "live" by theta, that is,
-    * set its second, third or fourth bit to 1 */
+__attribute__((target("avx512f"))) long
+stillgather512(col, choice, depth, live, on, shared)
+long col, choice[MAXMATCH + 1], depth, on, shared;
+char *live;
 
-   if (on) {
-      for (i = 0; i < ntwisted; i++)
-	 live[twisted[i]] |= 8;
-      for (i = 0; i < nuntwisted; i++)
-	 live[untwisted[i]] |= 4;
-   } else {
-      for (i = 0; i < ntwisted; i++)
-	 live[twisted[i]] |= 2;
-      for (i = 0; i < nuntwisted; i++)
-	 live[untwisted[i]] |= 2;
-   }
+/* Same as "stillgather", 16 codes at a time where there are that many */
+{
+   int sum[MAXSIGN] __attribute__((aligned(64)));
+   long i, j, twopower;
+   __m512i v, one, fifteen;
 
+   sum[0] = (int) col;
+   for (i = 2, twopower = 1; i <= depth; i++, twopower <<= 1) {
+      if (twopower < 16)
+	 for (j = 0; j < twopower; j++)
+	    sum[twopower + j] = sum[j] - (int) choice[i];
+      else {
+	 v = _mm512_set1_epi32((int) choice[i]);
+	 for (j = 0; j < twopower; j += 16)
+	    _mm512_store_si512((void *) (sum + twopower + j), _mm512_sub_epi32(_mm512_load_si512((void *) (sum + j)), v));
+      }
+   }
+   if (twopower < 16)
+      return (stillgather(col, choice, depth, live, on, shared));
+   one = _mm512_set1_epi32(1);
+   fifteen = _mm512_set1_epi32(15);
+   for (j = 0; j < twopower; j += 16) {
+      v = _mm512_abs_epi32(_mm512_load_si512((void *) (sum + j)));
+      v = _mm512_srlv_epi32(_mm512_i32gather_epi32(_mm512_srli_epi32(v, 1), (const void *) live, 1),
+	 _mm512_slli_epi32(_mm512_and_si512(v, one), 2));
+      if (_mm512_test_epi32_mask(v, fifteen) != 0xffff)
+	 return ((long) 0);
+   }
+   marklive(sum, twopower, live, on, shared);
    return ((long) 1);
 }
 
+__attribute__((target("sse2"))) long
+foldsse2(live, nchar)
+char *live;
+long nchar;
+
+/* Same as "foldlive" on all of "live", 32 codes at a time */
+{
+   long i, n;
+   __m128i v, lo, hi, low, high, one, sixteen;
 
-long
-updatelive(live, ncols, p)
-long *p, ncols;
+   low = _mm_set1_epi8((char) 15);
+   high = _mm_set1_epi8((char) 240);
+   one = _mm_set1_epi8((char) 1);
+   sixteen = _mm_set1_epi8((char) 16);
+   for (n = 0, i = 0; i + 16 <= nchar; i += 16) {
+      v = _mm_loadu_si128((__m128i *) (live + i));
+      lo = _mm_cmpeq_epi8(_mm_and_si128(v, low), low);
+      hi = _mm_cmpeq_epi8(_mm_and_si128(v, high), high);
+      _mm_storeu_si128((__m128i *) (live + i), _mm_or_si128(_mm_and_si128(lo, one), _mm_and_si128(hi, sixteen)));
+      n += __builtin_popcount((unsigned) _mm_movemask_epi8(lo) | (unsigned) _mm_movemask_epi8(hi) << 16);
+   }
+   return (n + foldlive(live, i, nchar));
+}
+
+__attribute__((target("avx2,popcnt"))) long
+foldavx2(live, nchar)
 char *live;
+long nchar;
 
-/* runs through "live" to see which colourings still have `real' signed
- * matchings sitting on all three pairs of colour classes, and updates "live"
- * accordingly; returns 1 if nlive got smaller and stayed >0, and 0 otherwise */
+/* Same as "foldlive" on all of "live", 64 codes at a time */
 {
-   long i, nlive, newnlive;
+   long i, n;
+   __m256i v, lo, hi, low, high, one, sixteen;
 
-   nlive = *p;
-   newnlive = 0;
-   if (live[0] > 1)
-      live[0] = (char) 15;
-   for (i = 0; i < ncols; i++) {
-      if (live[i] != 15)
-	 live[i] = 0;
-      else {
-	 newnlive++;
-	 live[i] = 1;
-      }
+   low = _mm256_set1_epi8((char) 15);
+   high = _mm256_set1_epi8((char) 240);
+   one = _mm256_set1_epi8((char) 1);
+   sixteen = _mm256_set1_epi8((char) 16);
+   for (n = 0, i = 0; i + 32 <= nchar; i += 32) {
+      v = _mm256_loadu_si256((__m256i *) (live + i));
+      lo = _mm256_cmpeq_epi8(_mm256_and_si256(v, low), low);
+      hi = _mm256_cmpeq_epi8(_mm256_and_si256(v, high), high);
+      _mm256_storeu_si256((__m256i *) (live + i), _mm256_or_si256(_mm256_and_si256(lo, one), _mm256_and_si256(hi, sixteen)));
+      n += __builtin_popcount((unsigned) _mm256_movemask_epi8(lo)) + __builtin_popcount((unsigned) _mm256_movemask_epi8(hi));
    }
-   *p = newnlive;
-   (void) printf("            %9ld", newnlive);
-   (void) fflush(stdout);
-   if ((newnlive < nlive) && (newnlive > 0))
-      return ((long) 1);
-   if (!newnlive)
-      (void) printf("\n\n\n                  ***  D-reducible  ***\n\n");
-   else
-      (void) printf("\n\n\n                ***  Not D-reducible  ***\n");
-   return ((long) 0);
+   return (n + foldlive(live, i, nchar));
 }
 
+#endif
+
 void
 strip(graph, edgeno)
 tp_confmat graph;
@@ -552,10 +3732,11 @@ long grav[], done[];
 }
 
 void
-findangles(graph, angle, diffangle, sameangle, contract)
+findangles(graph, angle, diffangle, sameangle, contract, J)
 tp_confmat graph;
 tp_angle angle,diffangle,sameangle;
 long contract[];
+tp_job *J;
 
 /* writes into angle[i] all edges with number >i on a common triangle T say
  * with edge i; and if there is a contract X given, and i is not in X, writes
@@ -571,36 +3752,36 @@ long contract[];
 
    edges = 3 * graph[0][0] - 3 - graph[0][1];
    if (edges >= EDGES) {
-      (void) printf("Configuration has more than %d edges\n", EDGES - 1);
-      exit(20);
+      (void) fprintf(J->out, "Configuration has more than %d edges\n", EDGES - 1);
+      Fail(J, (long) 20);
    }
    strip(graph, edgeno);
    for (i = 0; i < EDGES + 1; i++)
       contract[i] = 0;
    contract[0] = graph[0][4];	/* number of edges in contract */
    if (contract[0] < 0 || contract[0] > 4) {
-      (void) printf("         ***  ERROR: INVALID CONTRACT  ***\n\n");
-      exit(27);
+      (void) fprintf(J->out, "         ***  ERROR: INVALID CONTRACT  ***\n\n");
+      Fail(J, (long) 27);
    }
    for (i = 5; i <= 2 * contract[0] + 4; i++)
       if (graph[0][i] < 1 || graph[0][i] > graph[0][0]) {
-	 (void) printf("         ***  ERROR: ILLEGAL CONTRACT  ***\n\n");
-	 exit(29);
+	 (void) fprintf(J->out, "         ***  ERROR: ILLEGAL CONTRACT  ***\n\n");
+	 Fail(J, (long) 29);
       }
    contract[EDGES] = graph[0][3];
    for (i = 1; i <= contract[0]; i++) {
       u = graph[0][2 * i + 3];
       v = graph[0][2 * i + 4];
       if (edgeno[u][v] < 1) {
-	 (void) printf("         ***  ERROR: CONTRACT CONTAINS NON-EDGE  ***\n\n");
-	 exit(29);
+	 (void) fprintf(J->out, "         ***  ERROR: CONTRACT CONTAINS NON-EDGE  ***\n\n");
+	 Fail(J, (long) 29);
       }
       contract[edgeno[u][v]] = 1;
    }
    for (i = 1; i <= graph[0][1]; i++)
      if (contract[i]) {
-	 (void) printf("         ***  ERROR: CONTRACT IS NOT SPARSE  ***\n\n");
-	 exit(21);
+	 (void) fprintf(J->out, "         ***  ERROR: CONTRACT IS NOT SPARSE  ***\n\n");
+	 Fail(J, (long) 21);
       }
    for (i = 1; i <= edges; i++)
       diffangle[i][0] = sameangle[i][0] = angle[i][0] = 0;
@@ -619,8 +3800,8 @@ long contract[];
 	 b = edgeno[u][w];
 	 c = edgeno[u][v];
 	 if (contract[a] && contract[b]) {
-	    (void) printf("         ***  ERROR: CONTRACT IS NOT SPARSE  ***\n\n");
-	    exit(22);
+	    (void) fprintf(J->out, "         ***  ERROR: CONTRACT IS NOT SPARSE  ***\n\n");
+	    Fail(J, (long) 22);
 	 }
 	 if (a > c) {
 	    angle[c][++angle[c][0]] = a;
@@ -665,52 +3846,89 @@ long contract[];
 	    return;
       }
    }
-   (void) printf("         ***  ERROR: CONTRACT HAS NO TRIAD  ***\n\n");
-   exit(28);
+   (void) fprintf(J->out, "         ***  ERROR: CONTRACT HAS NO TRIAD  ***\n\n");
+   Fail(J, (long) 28);
 }
 
 
 long
-findlive(live, ncodes, angle, power, extentclaim)
+findlive(live, ncodes, angle, power, extentclaim, J)
 long ncodes, power[], extentclaim;
 tp_angle angle;
 char *live;
+tp_job *J;
 
 /* computes {\cal C}_0 and stores it in live. That is, computes codes of
  * colorings of the ring that are not restrictions of tri-colorings of the
  * free extension. Returns the number of such codes */
 
 {
-   long j, c[EDGES], i, u, *am;
-   long edges, ring, extent, bigno;
+   long c[EDGES], edges, ring, extent;
    long forbidden[EDGES];	/* called F in the notes */
 
    ring = angle[0][1];
    edges = angle[0][2];
-   bigno = (power[ring + 1] - 1) / 2;	/* needed in "record" */
    c[edges] = 1;
-   j = edges - 1;
-   c[j] = 2;
-   forbidden[j] = 5;
-   for (extent = 0;;) {
+   c[edges - 1] = 2;
+   forbidden[edges - 1] = 5;
+   extent = frontier ? frontlive(live, angle, power) : (long) -1;
+   if (extent >= 0)
+      ;
+   else if (J->split > 1 && edges > ring + 2)
+      extent = splitlive(live, ncodes, angle, power, c, J);
+   else {
+      extent = 0;
+      livetree(c, forbidden, edges - 1, angle, power, live, &extent, (unsigned char *) NULL);
+   }
+   printstatus(ring, ncodes, extent, extentclaim, J);
+   return (ncodes - extent);
+}
+
+
+void
+livetree(c, forbidden, top, angle, power, live, pextent, seen)
+long c[EDGES], forbidden[EDGES], top, power[], *pextent;
+tp_angle angle;
+char *live;
+unsigned char *seen;
+
+/* Runs through the tri-colourings c of the edges below "top" that go with
+ * the colour c[top] of top and the colours of the edges above it (the
+ * lower-numbered edges are coloured later), and "record"s each of them in
+ * live, counting in *pextent. If "seen" is not NULL their codes are put in
+ * the set seen instead. c[top] must be the only colour not in
+ * forbidden[top]. The last three edges are left to "livebits", if they are
+ * below top. */
+{
+   long j, i, u, ring, bigno, colno, leaf;
+   unsigned char *am;
+
+   ring = angle[0][1];
+   bigno = (power[ring + 1] - 1) / 2;	/* needed in "record" */
+   leaf = top > ring + 3 ? ring + 4 : ring + 1;
+   j = top;
+   for (;;) {
       while (forbidden[j] & c[j]) {
 	 c[j] <<= 1;
 	 while (c[j] & 8) {
-	    if (j >= edges - 1) {
-	       printstatus(ring, ncodes, extent, extentclaim);
-	       return (ncodes - extent);
-	    }
+	    if (j >= top)
+	       return;
 	    c[++j] <<= 1;
 	 }
       }
-      if (j == ring + 1) {
-	 record(c, power, ring, angle, live, &extent, bigno);
+      if (j == leaf) {
+	 if (leaf > ring + 1)
+	    livebits(c, angle, power, live, pextent, seen, bigno);
+	 else if (seen == NULL)
+	    record(c, power, ring, angle, live, pextent, bigno);
+	 else {
+	    colno = colourcode(c, power, ring, angle, bigno);
+	    seen[colno >> 3] |= (unsigned char) (1 << (colno & 7));
+	 }
 	 c[j] <<= 1;
 	 while (c[j] & 8) {
-	    if (j >= edges - 1) {
-	       printstatus(ring, ncodes, extent, extentclaim);
-	       return (ncodes - extent);
-	    }
+	    if (j >= top)
+	       return;
 	    c[++j] <<= 1;
 	 }
       } else {
@@ -723,35 +3941,429 @@ char *live;
    }
 }
 
+
+void
+livebits(c, angle, power, live, pextent, seen, bigno)
+long c[EDGES], power[], *pextent, bigno;
+tp_angle angle;
+char *live;
+unsigned char *seen;
+
+/* Does the work of "livetree" at edge ring+4, whose colour and those of the
+ * edges above it are in c. Each of the 64 bits of a word stands for a
+ * colouring of edges ring+1 to ring+3: digit t of the bit number in base 4
+ * is 0, 1 or 2 if edge ring+1+t has colour 1, 2 or 4, and 3 if it has none.
+ * For each edge and colour there is a word of the bits in which the edge has
+ * the colour, so that the tri-colourings are found for all 64 at once, and
+ * so are the colours of the ring edges next to edges ring+1 to ring+3. The
+ * codes of the ring colourings are then found as in "colourcode", where
+ * the weights of the other ring edges are the same for all of them. */
+{
+   long i, k, t, e, f, l, d, ring, ndep, dep[MAXRING + 1], weight[5], base[5], min, max, colno;
+   unsigned char *am;
+   unsigned long valid, m, plane[4][3], ringplane[MAXRING + 1][3];
+   static unsigned long digit[3] = {0x1111111111111111UL, 0x000f000f000f000fUL, 0x000000000000ffffUL};
+
+   ring = angle[0][1];
+   for (valid = ~0UL, t = 0; t < 3; t++) {
+      for (k = 0; k < 3; k++)
+	 plane[t + 1][k] = digit[t] << (k << (2 * t));
+      valid &= ~(digit[t] << (3 << (2 * t)));
+   }
+   for (e = ring + 1; e <= ring + 3; e++)
+      for (am = angle[e], i = 1; i <= am[0]; i++)
+	 for (f = am[i], k = 0; k < 3; k++)
+	    valid &= ~(plane[e - ring][k] & LANES(c, plane, f, k, ring));
+   if (!valid)
+      return;
+   base[1] = base[2] = base[4] = 0;
+   for (ndep = 0, i = 1; i <= ring; i++) {
+      e = angle[i][1];
+      f = angle[i][2];
+      if (e > ring + 3 && f > ring + 3)
+	 base[7 - c[e] - c[f]] += power[i];
+      else {
+	 dep[ndep] = i;
+	 for (k = 0; k < 3; k++)	/* it has the colour neither has */
+	    ringplane[ndep][k] = ~(LANES(c, plane, e, k, ring) | LANES(c, plane, f, k, ring));
+	 ndep++;
+      }
+   }
+   for (m = valid; m; m &= m - 1) {
+      l = __builtin_ctzl(m);
+      weight[1] = base[1];
+      weight[2] = base[2];
+      weight[4] = base[4];
+      for (d = 0; d < ndep; d++)
+	 for (k = 0; k < 3; k++)
+	    if ((ringplane[d][k] >> l) & 1)
+	       weight[1 << k] += power[dep[d]];
+      min = max = weight[4];	/* as in "colourcode" */
+      for (i = 1; i <= 2; i++) {
+	 if (weight[i] < min)
+	    min = weight[i];
+	 else if (weight[i] > max)
+	    max = weight[i];
+      }
+      colno = bigno - 2 * min - max;
+      if (seen != NULL)
+	 seen[colno >> 3] |= (unsigned char) (1 << (colno & 7));
+      else if (LIVE(live, colno)) {	/* as in "record" */
+	 (*pextent)++;
+	 live[colno >> 1] &= ~LIVEBITS(colno, 15);
+      }
+   }
+}
+
+
+long
+splitlive(live, ncodes, angle, power, c, J)
+long ncodes, power[], c[EDGES];
+tp_angle angle;
+char *live;
+tp_job *J;
+
+/* Does the work of "livetree" for "findlive" with J->split threads, and
+ * returns the number of codes removed from live. c holds the colours of
+ * the top two edges. The colourings of the top few edges are listed first;
+ * each is a part of the work, which the threads claim in turn, putting the
+ * codes they find in sets of their own. These are merged into live at the
+ * end, so the result is the same as that of "livetree". */
+{
+   long i, j, k, n, u, col, edges, nthreads, extent, (*next)[EDGES];
+   unsigned char *am;
+   unsigned char m;
+   tp_livesplit S;
+   pthread_t *thread;
+
+   edges = angle[0][2];
+   S.prefix = (long (*)[EDGES]) malloc(LIVEPARTS * sizeof(*S.prefix));
+   next = (long (*)[EDGES]) malloc(LIVEPARTS * sizeof(*next));
+   S.seen = (unsigned char **) malloc(J->split * sizeof(unsigned char *));
+   thread = (pthread_t *) malloc(J->split * sizeof(pthread_t));
+   if (S.prefix == NULL || next == NULL || S.seen == NULL || thread == NULL) {
+      free(S.prefix);
+      free(next);
+      free(S.seen);
+      free(thread);
+      (void) fprintf(J->out, "Not enough memory for %ld threads\n", J->split);
+      Fail(J, (long) 44);
+   }
+   (void) memcpy(S.prefix[0], c, sizeof(*S.prefix));
+   S.nprefix = 1;
+   /* colour one more edge while there are too few parts for the threads */
+   for (S.top = edges - 1; S.top > angle[0][1] + 1 && S.nprefix < 8 * J->split && 3 * S.nprefix <= LIVEPARTS; S.top--) {
+      am = angle[S.top - 1];
+      for (n = 0, k = 0; k < S.nprefix; k++) {
+	 for (u = 0, i = 1; i <= am[0]; i++)
+	    u |= S.prefix[k][am[i]];
+	 for (col = 1; col <= 4; col <<= 1)
+	    if (!(u & col)) {
+	       (void) memcpy(next[n], S.prefix[k], sizeof(*next));
+	       next[n++][S.top - 1] = col;
+	    }
+      }
+      (void) memcpy(S.prefix, next, n * sizeof(*next));
+      S.nprefix = n;
+   }
+   free(next);
+   S.next = S.nseen = S.status = 0;
+   S.angle = angle;
+   S.power = power;
+   S.ncodes = ncodes;
+   nthreads = J->split < S.nprefix ? J->split : S.nprefix;
+   for (i = 1; i < nthreads; i++)
+      if (pthread_create(&thread[i], NULL, livehelper, (void *) &S)) {
+	 (void) printf("Can't start thread %ld\n", i + 1);
+	 exit(45);
+      }
+   (void) livehelper((void *) &S);
+   for (i = 1; i < nthreads; i++)
+      (void) pthread_join(thread[i], NULL);
+   free(thread);
+   free(S.prefix);
+   if (S.status) {
+      for (k = 0; k < S.nseen; k++)
+	 free(S.seen[k]);
+      free(S.seen);
+      (void) fprintf(J->out, "Not enough memory for %ld threads\n", nthreads);
+      Fail(J, S.status);
+   }
+   for (extent = 0, i = 0; i <= ncodes >> 3; i++) {
+      for (m = 0, k = 0; k < S.nseen; k++)
+	 m |= S.seen[k][i];
+      for (j = 8 * i; m; j++, m >>= 1)
+	 if ((m & 1) && LIVE(live, j)) {
+	    extent++;
+	    live[j >> 1] &= ~LIVEBITS(j, 15);
+	 }
+   }
+   for (k = 0; k < S.nseen; k++)
+      free(S.seen[k]);
+   free(S.seen);
+   return (extent);
+}
+
+
+long
+frontlive(live, angle, power)
+char *live;
+tp_angle angle;
+long power[];
+
+/* Does the work of "livetree" for "findlive" by going down the edges in the
+ * same order, but keeping only what is needed of each partial colouring:
+ * the colours of the edges on the "frontier", which some edge not yet
+ * coloured is on a triangle with, and the colours of the ring edges both of
+ * whose neighbours in "angle" are coloured. Partial colourings that agree
+ * on these are the same from then on, and are kept once. Returns the number
+ * of codes removed from live, or -1, having done nothing, if the frontier
+ * gets wider than 32 edges or there are more than FRONTSTATES partial
+ * colourings. */
+{
+   long i, j, k, n, e, f, x, y, col, forb, ring, edges, bigno, nfront, nnext, extent, w[3], min, max, colno;
+   long need[EDGES + 1], front[32], next[32], from[32], slot[EDGES + 1];
+   unsigned long r, key, fkey;
+   tp_frontier A, B, *S, *T, *U;
+
+   ring = angle[0][1];
+   edges = angle[0][2];
+   bigno = (power[ring + 1] - 1) / 2;
+   /* need[f] is the lowest edge that needs the colour of f: one on a
+    * triangle with it, or the lower of the two neighbours of a ring edge
+    * next to it, which is when the colour of that ring edge is found */
+   for (f = 1; f <= edges; f++)
+      need[f] = f;
+   for (j = ring + 1; j <= edges; j++)
+      for (i = 1; i <= angle[j][0]; i++)
+	 if (need[angle[j][i]] > j)
+	    need[angle[j][i]] = j;
+   for (i = 1; i <= ring; i++) {
+      x = angle[i][1];
+      y = angle[i][2];
+      j = x < y ? x : y;
+      if (need[x] > j)
+	 need[x] = j;
+      if (need[y] > j)
+	 need[y] = j;
+   }
+   S = &A;
+   T = &B;
+   S->size = T->size = S->n = T->n = 0;
+   S->front = T->front = S->ring = T->ring = NULL;
+   if (!frontadd(S, (unsigned long) 0, (unsigned long) 0)) {	/* the empty colouring */
+      frontfree(S, T);
+      return ((long) -1);
+   }
+   nfront = 0;
+   for (j = edges; j > ring; j--) {
+      /* the frontier after colouring j, and where each of it comes from */
+      for (nnext = 0, k = 0; k < nfront; k++)
+	 if (need[front[k]] < j) {
+	    from[nnext] = k;
+	    next[nnext++] = front[k];
+	 }
+      if (need[j] < j) {
+	 from[nnext] = -1;
+	 next[nnext++] = j;
+      }
+      if (nnext > 32) {
+	 frontfree(S, T);
+	 return ((long) -1);
+      }
+      for (k = 0; k < nfront; k++)
+	 slot[front[k]] = k;
+      frontclear(T);
+      for (i = 0; i < S->size; i++) {
+	 if ((fkey = S->front[i]) == ~0UL)
+	    continue;
+	 for (forb = 0, k = 1; k <= angle[j][0]; k++)
+	    forb |= 1 << ((fkey >> 2 * slot[angle[j][k]]) & 3);
+	 if (j == edges)	/* as in "findlive" */
+	    forb = 6;
+	 else if (j == edges - 1)
+	    forb = 5;
+	 for (col = 0; col < 3; col++) {
+	    if (forb & (1 << col))
+	       continue;
+	    r = S->ring[i];
+	    for (k = 1; k <= ring; k++) {
+	       x = angle[k][1];
+	       y = angle[k][2];
+	       if ((x < y ? x : y) != j)
+		  continue;
+	       e = x == j ? y : x;	/* it has the colour neither has */
+	       r |= (unsigned long) (3 - col - ((fkey >> 2 * slot[e]) & 3)) << 2 * (k - 1);
+	    }
+	    for (key = 0, n = 0; n < nnext; n++)
+	       key |= (from[n] < 0 ? (unsigned long) col : (fkey >> 2 * from[n]) & 3) << 2 * n;
+	    if (!frontadd(T, key, r)) {
+	       frontfree(S, T);
+	       return ((long) -1);
+	    }
+	 }
+      }
+      U = S;
+      S = T;
+      T = U;
+      for (k = 0; k < nnext; k++)
+	 front[k] = next[k];
+      nfront = nnext;
+   }
+   for (extent = 0, i = 0; i < S->size; i++) {
+      if (S->front[i] == ~0UL)
+	 continue;
+      w[0] = w[1] = w[2] = 0;
+      for (k = 1; k <= ring; k++)
+	 w[(S->ring[i] >> 2 * (k - 1)) & 3] += power[k];
+      min = max = w[2];	/* as in "colourcode" */
+      for (k = 0; k <= 1; k++) {
+	 if (w[k] < min)
+	    min = w[k];
+	 else if (w[k] > max)
+	    max = w[k];
+      }
+      colno = bigno - 2 * min - max;
+      if (LIVE(live, colno)) {	/* as in "record" */
+	 extent++;
+	 live[colno >> 1] &= ~LIVEBITS(colno, 15);
+      }
+   }
+   frontfree(S, T);
+   return (extent);
+}
+
+
+long
+frontadd(S, front, ring)
+tp_frontier *S;
+unsigned long front, ring;
+
+/* Adds the partial colouring given by front and ring to S, unless it is
+ * there already, doubling S when half full. Returns 0 if S would have more
+ * than FRONTSTATES entries or memory runs out, else 1 */
+{
+   unsigned long *f, *r, h;
+   long i, size;
+
+   if (2 * S->n >= S->size) {
+      if (S->n >= FRONTSTATES)
+	 return ((long) 0);
+      f = S->front;
+      r = S->ring;
+      size = S->size;
+      S->size = size ? 2 * size : 1024;
+      S->front = (unsigned long *) malloc(S->size * sizeof(unsigned long));
+      S->ring = (unsigned long *) malloc(S->size * sizeof(unsigned long));
+      if (S->front == NULL || S->ring == NULL) {
+	 free(S->front);
+	 free(S->ring);
+	 S->front = f;
+	 S->ring = r;
+	 S->size = size;
+	 return ((long) 0);
+      }
+      frontclear(S);
+      for (i = 0; i < size; i++)
+	 if (f[i] != ~0UL)
+	    (void) frontadd(S, f[i], r[i]);
+      free(f);
+      free(r);
+   }
+   h = (front * 0x9e3779b97f4a7c15UL ^ ring) * 0xff51afd7ed558ccdUL;
+   for (i = (long) (h >> 20) & (S->size - 1); S->front[i] != ~0UL; i = (i + 1) & (S->size - 1))
+      if (S->front[i] == front && S->ring[i] == ring)
+	 return ((long) 1);
+   S->front[i] = front;
+   S->ring[i] = ring;
+   S->n++;
+   return ((long) 1);
+}
+
+
+void
+frontclear(S)
+tp_frontier *S;
+
+/* Empties S, keeping its space */
+{
+   long i;
+
+   for (i = 0; i < S->size; i++)
+      S->front[i] = ~0UL;
+   S->n = 0;
+}
+
+
+void
+frontfree(S, T)
+tp_frontier *S, *T;
+
+/* Frees the space of the two sets used by "frontlive" */
+{
+   free(S->front);
+   free(S->ring);
+   free(T->front);
+   free(T->ring);
+}
+
+
+void *
+livehelper(arg)
+void *arg;
+
+/* The body of each thread of "splitlive" */
+{
+   long i, c[EDGES], forbidden[EDGES];
+   unsigned char *seen;
+   tp_livesplit *S;
+
+   S = (tp_livesplit *) arg;
+   seen = (unsigned char *) calloc((S->ncodes >> 3) + 1, sizeof(unsigned char));
+   if (seen == NULL) {
+      __atomic_store_n(&S->status, (long) 44, __ATOMIC_RELAXED);
+      return (NULL);
+   }
+   S->seen[__atomic_fetch_add(&S->nseen, (long) 1, __ATOMIC_RELAXED)] = seen;
+   while ((i = __atomic_fetch_add(&S->next, (long) 1, __ATOMIC_RELAXED)) < S->nprefix) {
+      (void) memcpy(c, S->prefix[i], sizeof(c));
+      forbidden[S->top] = 7 ^ c[S->top];
+      livetree(c, forbidden, S->top, S->angle, S->power, (char *) NULL, (long *) NULL, seen);
+   }
+   return (NULL);
+}
+
 void
-checkcontract(live, nlive, diffangle, sameangle, contract, power)
+checkcontract(live, nlive, diffangle, sameangle, contract, power, J)
 tp_angle diffangle, sameangle;
 long nlive, contract[EDGES + 1], power[];
 char *live;
+tp_job *J;
 /* checks that no colouring in live is the restriction to E(R) of a
  * tri-coloring of the free extension modulo the specified contract */
 {
-   long j, c[EDGES], i, u, *dm, *sm;
+   long j, c[EDGES], i, u;
+   unsigned char *dm, *sm;
    long ring, bigno;
    long forbidden[EDGES];	/* called F in the notes */
    long start;	/* called s in the notes */
 
    if (!nlive) {
       if (!contract[0]) {
-	 (void) printf("\n");
+	 (void) fprintf(J->out, "\n");
 	 return;
       } else {
-	 (void) printf("         ***  ERROR: CONTRACT PROPOSED  ***\n\n");
-	 exit(23);
+	 (void) fprintf(J->out, "         ***  ERROR: CONTRACT PROPOSED  ***\n\n");
+	 Fail(J, (long) 23);
       }
    }
    if (!contract[0]) {
-      (void) printf("       ***  ERROR: NO CONTRACT PROPOSED  ***\n\n");
-      exit(24);
+      (void) fprintf(J->out, "       ***  ERROR: NO CONTRACT PROPOSED  ***\n\n");
+      Fail(J, (long) 24);
    }
    if (nlive != contract[EDGES]) {
-      (void) printf("       ***  ERROR: DISCREPANCY IN EXTERIOR SIZE  ***\n\n");
-      exit(25);
+      (void) fprintf(J->out, "       ***  ERROR: DISCREPANCY IN EXTERIOR SIZE  ***\n\n");
+      Fail(J, (long) 25);
    }
    ring = diffangle[0][1];
    bigno = (power[ring + 1] - 1) / 2;	/* needed in "inlive" */
@@ -776,7 +4388,7 @@ char *live;
 	 while (c[j] & 8) {
 	    while (contract[++j]);
 	    if (j >= start) {
-	       (void) printf("               ***  Contract confirmed  ***\n\n");
+	       (void) fprintf(J->out, "               ***  Contract confirmed  ***\n\n");
 	       return;
 	    }
 	    c[j] <<= 1;
@@ -784,14 +4396,14 @@ char *live;
       }
       if (j == 1) {
 	 if (inlive(c, power, ring, live, bigno)) {
-	    (void) printf("       ***  ERROR: INPUT CONTRACT IS INCORRECT  ***\n\n");
-	    exit(26);
+	    (void) fprintf(J->out, "       ***  ERROR: INPUT CONTRACT IS INCORRECT  ***\n\n");
+	    Fail(J, (long) 26);
 	 }
 	 c[j] <<= 1;
 	 while (c[j] & 8) {
 	    while (contract[++j]);
 	    if (j >= start) {
-	       (void) printf("               ***  Contract confirmed  ***\n\n");
+	       (void) fprintf(J->out, "               ***  Contract confirmed  ***\n\n");
 	       return;
 	    }
 	    c[j] <<= 1;
@@ -811,36 +4423,53 @@ char *live;
 }
 
 void
-printstatus(ring, totalcols, extent, extentclaim)
+printstatus(ring, totalcols, extent, extentclaim, J)
 long ring, totalcols, extent, extentclaim;
+tp_job *J;
 
 {
-   static long simatchnumber[] = {0L, 0L, 1L, 3L, 10L, 30L, 95L, 301L, 980L, 3228L, 10797L, 36487L, 124542L, 428506L, 1485003L};
-
-   (void) printf("\n\n   This has ring-size %ld, so there are %ld colourings total,\n",ring, totalcols);
-   (void) printf("   and %ld balanced signed matchings.\n",simatchnumber[ring]);
+   (void) fprintf(J->out, "\n\n   This has ring-size %ld, so there are %ld colourings total,\n",ring, totalcols);
+   (void) fprintf(J->out, "   and %ld balanced signed matchings.\n",matchnumber(ring));
 
-   (void) printf("\n   There are %ld colourings that extend to the configuration.", extent);
+   (void) fprintf(J->out, "\n   There are %ld colourings that extend to the configuration.", extent);
    if (extent != extentclaim) {
-      (void) printf("\n   *** ERROR: DISCREPANCY IN NUMBER OF EXTENDING COLOURINGS ***\n");
-      exit(31);
+      (void) fprintf(J->out, "\n   *** ERROR: DISCREPANCY IN NUMBER OF EXTENDING COLOURINGS ***\n");
+      Fail(J, (long) 31);
    }
-   (void) printf("\n\n            remaining               remaining balanced\n");
-   (void) printf("           colourings               signed matchings\n");
-   (void) printf("\n              %7ld", totalcols - extent);
-   (void) fflush(stdout);
+   (void) fprintf(J->out, "\n\n            remaining               remaining balanced\n");
+   (void) fprintf(J->out, "           colourings               signed matchings\n");
+   (void) fprintf(J->out, "\n              %7ld", totalcols - extent);
+   (void) fflush(J->out);
 }
 
 void
 record(col, power, ring, angle, live, p, bigno)
-long col[], power[], ring, angle[][5], *p, bigno;
+long col[], power[], ring, *p, bigno;
+tp_angle angle;
 char *live;
 
 /* Given a colouring specified by a 1,2,4-valued function "col", it computes
  * the corresponding number, checks if it is in live, and if so removes it. */
 
 {
-   long weight[5], colno, sum, i, min, max, w;
+   long colno;
+
+   colno = colourcode(col, power, ring, angle, bigno);
+   if (LIVE(live, colno)) {
+      (*p)++;
+      live[colno >> 1] &= ~LIVEBITS(colno, 15);
+   }
+}
+
+long
+colourcode(col, power, ring, angle, bigno)
+long col[], power[], ring, bigno;
+tp_angle angle;
+
+/* Returns the number of the colouring of the ring given by "col", as in
+ * "record" */
+{
+   long weight[5], sum, i, min, max, w;
 
    for (i = 1; i < 5; i++)
       weight[i] = 0;
@@ -856,11 +4485,7 @@ char *live;
       else if (w > max)
 	 max = w;
    }
-   colno = bigno - 2 * min - max;
-   if (live[colno]) {
-      (*p)++;
-      live[colno] = 0;
-   }
+   return (bigno - 2 * min - max);
 }
 
 long
@@ -886,18 +4511,20 @@ char *live;
 	 max = w;
    }
    colno = bigno - 2 * min - max;
-   return ((long) live[colno]);
+   return ((long) LIVE(live, colno));
 }
 
 
 long
-ReadConf(A, F, C)
+ReadConf(A, F, C, J)
 tp_confmat A;
 FILE *F;
 long *C;
+tp_job *J;
 
 /* Reads one graph from file F and stores in A, if C!=NULL puts coordinates
- * there. If successful returns 0, on end of file returns 1, if error exits. */
+ * there. If successful returns 0, on end of file returns 1, if error calls
+ * "Fail" on J. */
 {
    char S[256], *t, name[256];
    long d, i, j, k, n, r, a, p;
@@ -912,31 +4539,31 @@ long *C;
    (void) fgets(S, sizeof(S), F);
    /* No verts, ringsize, no extendable colourings, max cons subset */
    if (sscanf(S, "%ld%ld%ld%ld", &A[0][0], &A[0][1], &A[0][2], &A[0][3]) != 4) {
-      (void) printf("Error on line 2 while reading %s\n", name);
-      exit(11);
+      (void) fprintf(J->out, "Error on line 2 while reading %s\n", name);
+      Fail(J, (long) 11);
    }
    n = A[0][0];
    r = A[0][1];
    if (n >= VERTS) {
-      (void) printf("%s has more than %d vertices\n", name, VERTS - 1);
-      exit(17);
+      (void) fprintf(J->out, "%s has more than %d vertices\n", name, VERTS - 1);
+      Fail(J, (long) 17);
    }
    (void) fgets(S, sizeof(S), F);	/* Contract */
    i = sscanf(S, "%ld%ld%ld%ld%ld%ld%ld%ld%ld", &A[0][4], &A[0][5], &A[0][6], &A[0][7], &A[0][8], &A[0][9], &A[0][10], &A[0][11], &A[0][12]);
    if (2 * A[0][4] + 1 != i) {
-      (void) printf("Error on line 3 while reading %s\n", name);
-      exit(13);
+      (void) fprintf(J->out, "Error on line 3 while reading %s\n", name);
+      Fail(J, (long) 13);
    }
    /* Reading adjacency list */
    for (i = 1; i <= n; i++) {
       (void) fgets(S, sizeof(S), F);
       if (sscanf(S, "%ld%ld", &j, &A[i][0]) != 2 || i != j) {
-	 (void) printf("Error while reading vertex %ld of %s\n", i, name);
-	 exit(14);
+	 (void) fprintf(J->out, "Error while reading vertex %ld of %s\n", i, name);
+	 Fail(J, (long) 14);
       }
       if (A[i][0] >= DEG) {
-	 (void) printf("Vertex degree larger than %d in %s\n", DEG - 1, name);
-	 exit(14);
+	 (void) fprintf(J->out, "Vertex degree larger than %d in %s\n", DEG - 1, name);
+	 Fail(J, (long) 14);
       }
 
       for (t = S; *t < '0' || *t > '9'; t++);
@@ -945,8 +4572,8 @@ long *C;
       for (; *t >= '0' && *t <= '9'; t++);
       for (j = 1; j <= A[i][0]; j++) {
 	 if (sscanf(t, "%ld", &A[i][j]) != 1) {
-	    (void) printf("Error while reading neighbour %ld of %ld of %s\n", j, i, name);
-	    exit(15);
+	    (void) fprintf(J->out, "Error while reading neighbour %ld of %ld of %s\n", j, i, name);
+	    Fail(J, (long) 15);
 	 }
 	 for (; *t < '0' || *t > '9'; t++);
 	 for (; *t >= '0' && *t <= '9'; t++);
@@ -963,47 +4590,47 @@ long *C;
       else
 	 k = sscanf(S, "%ld%ld%ld%ld%ld%ld%ld%ld", C + i, C + i + 1, C + i + 2, C + i + 3, C + i + 4, C + i + 5, C + i + 6, C + i + 7);
       if (k == 0) {
-	 (void) printf("Error while reading coordinates of %s\n", name);
-	 exit(17);
+	 (void) fprintf(J->out, "Error while reading coordinates of %s\n", name);
+	 Fail(J, (long) 17);
       }
       i += k;
    }	/* for i */
    (void) fgets(S, sizeof(S), F);
    for (t = S; *t == ' ' || *t == '\t'; t++);
    if (*t != '\n' && *t != '\0') {
-      (void) printf("No blank line following configuration %s\n", name);
-      exit(18);
+      (void) fprintf(J->out, "No blank line following configuration %s\n", name);
+      Fail(J, (long) 18);
    }
    /* verifying condition (1) */
    if (r < 2 || n <= r)
-      ReadErr(1, name);
+      ReadErr(1, name, J);
    /* condition (2) */
    for (i = 1; i <= r; i++)
       if (A[i][0] < 3 || A[i][0] >= n)
-	 ReadErr(2, name);
+	 ReadErr(2, name, J);
    for (i = r + 1; i <= n; i++)
       if (A[i][0] < 5 || A[i][0] >= n)
-	 ReadErr(2, name);
+	 ReadErr(2, name, J);
    /* condition (3) */
    for (i = 1; i <= n; i++)
       for (j = 1; j <= A[i][0]; j++)
 	 if (A[i][j] < 1 || A[i][j] > n)
-	    ReadErr(3, name);
+	    ReadErr(3, name, J);
    /* condition (4) */
    for (i = 1; i <= r; i++) {
       if (A[i][1] != (i == r ? 1 : i + 1))
-	 ReadErr(4, name);
+	 ReadErr(4, name, J);
       if (A[i][A[i][0]] != (i == 1 ? r : i - 1))
-	 ReadErr(4, name);
+	 ReadErr(4, name, J);
       for (j = 2; j < A[i][0]; j++)
 	 if (A[i][j] <= r || A[i][j] > n)
-	    ReadErr(4, name);
+	    ReadErr(4, name, J);
    }
    /* condition (5) */
    for (i = 1, k = 0; i <= n; i++)
       k += A[i][0];
    if (k != 6 * (n - 1) - 2 * r)
-      ReadErr(5, name);
+      ReadErr(5, name, J);
    /* condition (6) */
    for (i = r + 1; i <= n; i++) {
       k = 0;
@@ -1015,7 +4642,7 @@ long *C;
 	       k++;
 	 }
       if (k > 2)
-	 ReadErr(6, name);
+	 ReadErr(6, name, J);
    }
    /* condition (7) */
    for (i = 1; i <= n; i++)
@@ -1031,18 +4658,19 @@ long *C;
 	    if (a == A[k][p] && i == A[k][p + 1])
 	       break;
 	 if (p == A[k][0] && (a != A[k][p] || i != A[k][1]))
-	    ReadErr(7, name);
+	    ReadErr(7, name, J);
       }
    return ((long) 0);
 }/* ReadConf */
 
 void
-ReadErr(n, name)
+ReadErr(n, name, J)
 int n;
 char name[];
+tp_job *J;
 {
-   (void) printf("Error %d while reading configuration %s\n", n, name);
-   exit(57);
+   (void) fprintf(J->out, "Error %d while reading configuration %s\n", n, name);
+   Fail(J, (long) 57);
 }
 
 /* End of file reduce.c */
@@ -2,7 +2,7 @@
 
 make all
 
-time ./reduce U_2822.conf
+time ./reduce -j $(nproc) --schedule U_2822.conf
 
 time ./discharge p5_2822 U_2822.conf L_42
 time ./discharge p6_2822 U_2822.conf L_42